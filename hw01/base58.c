@@ -1,93 +1,908 @@
-#include <ctype.h>
-#include <stdbool.h>
+#include "base58.h"
+#include "sha256.h"
+
 #include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
-#define BASE58 "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz"
-#define MAXIMUM 0xffffffff
+/*
+ * Reverse lookup of an alphabet, a single load classifies the input byte:
+ * digits map to DIGIT_FLAG | value, whitespace (as in isspace() of the
+ * "C" locale) to SPACE_FLAG and everything else stays 0, i.e. invalid.
+ */
+#define DIGIT_FLAG 0x40
+#define SPACE_FLAG 0x80
+#define DIGIT_MASK 0x3f
+
+#define SPACE_ENTRIES \
+    ['\t'] = SPACE_FLAG, ['\n'] = SPACE_FLAG, ['\v'] = SPACE_FLAG, ['\f'] = SPACE_FLAG, ['\r'] = SPACE_FLAG, \
+    [' '] = SPACE_FLAG
+
+/*
+ * Alphabets are padded to 64 characters, so that they double as the four
+ * pshufb tables of the SIMD kernels.
+ */
+static const char bitcoin_alphabet[64] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+static const char ripple_alphabet[64] = "rpshnaf39wBUDNEGHJKLM4PQRST7VWXYZ2bcdeCg65jkm8oFqi1tuvAxyz";
+static const char flickr_alphabet[64] = "123456789abcdefghijkmnopqrstuvwxyzABCDEFGHJKLMNPQRSTUVWXYZ";
+
+static const unsigned char bitcoin_table[256] = {
+        SPACE_ENTRIES,
+        ['1'] = DIGIT_FLAG | 0, ['2'] = DIGIT_FLAG | 1, ['3'] = DIGIT_FLAG | 2, ['4'] = DIGIT_FLAG | 3,
+        ['5'] = DIGIT_FLAG | 4, ['6'] = DIGIT_FLAG | 5, ['7'] = DIGIT_FLAG | 6, ['8'] = DIGIT_FLAG | 7,
+        ['9'] = DIGIT_FLAG | 8, ['A'] = DIGIT_FLAG | 9, ['B'] = DIGIT_FLAG | 10, ['C'] = DIGIT_FLAG | 11,
+        ['D'] = DIGIT_FLAG | 12, ['E'] = DIGIT_FLAG | 13, ['F'] = DIGIT_FLAG | 14, ['G'] = DIGIT_FLAG | 15,
+        ['H'] = DIGIT_FLAG | 16, ['J'] = DIGIT_FLAG | 17, ['K'] = DIGIT_FLAG | 18, ['L'] = DIGIT_FLAG | 19,
+        ['M'] = DIGIT_FLAG | 20, ['N'] = DIGIT_FLAG | 21, ['P'] = DIGIT_FLAG | 22, ['Q'] = DIGIT_FLAG | 23,
+        ['R'] = DIGIT_FLAG | 24, ['S'] = DIGIT_FLAG | 25, ['T'] = DIGIT_FLAG | 26, ['U'] = DIGIT_FLAG | 27,
+        ['V'] = DIGIT_FLAG | 28, ['W'] = DIGIT_FLAG | 29, ['X'] = DIGIT_FLAG | 30, ['Y'] = DIGIT_FLAG | 31,
+        ['Z'] = DIGIT_FLAG | 32, ['a'] = DIGIT_FLAG | 33, ['b'] = DIGIT_FLAG | 34, ['c'] = DIGIT_FLAG | 35,
+        ['d'] = DIGIT_FLAG | 36, ['e'] = DIGIT_FLAG | 37, ['f'] = DIGIT_FLAG | 38, ['g'] = DIGIT_FLAG | 39,
+        ['h'] = DIGIT_FLAG | 40, ['i'] = DIGIT_FLAG | 41, ['j'] = DIGIT_FLAG | 42, ['k'] = DIGIT_FLAG | 43,
+        ['m'] = DIGIT_FLAG | 44, ['n'] = DIGIT_FLAG | 45, ['o'] = DIGIT_FLAG | 46, ['p'] = DIGIT_FLAG | 47,
+        ['q'] = DIGIT_FLAG | 48, ['r'] = DIGIT_FLAG | 49, ['s'] = DIGIT_FLAG | 50, ['t'] = DIGIT_FLAG | 51,
+        ['u'] = DIGIT_FLAG | 52, ['v'] = DIGIT_FLAG | 53, ['w'] = DIGIT_FLAG | 54, ['x'] = DIGIT_FLAG | 55,
+        ['y'] = DIGIT_FLAG | 56, ['z'] = DIGIT_FLAG | 57,
+};
+
+static const unsigned char ripple_table[256] = {
+        SPACE_ENTRIES,
+        ['r'] = DIGIT_FLAG | 0, ['p'] = DIGIT_FLAG | 1, ['s'] = DIGIT_FLAG | 2, ['h'] = DIGIT_FLAG | 3,
+        ['n'] = DIGIT_FLAG | 4, ['a'] = DIGIT_FLAG | 5, ['f'] = DIGIT_FLAG | 6, ['3'] = DIGIT_FLAG | 7,
+        ['9'] = DIGIT_FLAG | 8, ['w'] = DIGIT_FLAG | 9, ['B'] = DIGIT_FLAG | 10, ['U'] = DIGIT_FLAG | 11,
+        ['D'] = DIGIT_FLAG | 12, ['N'] = DIGIT_FLAG | 13, ['E'] = DIGIT_FLAG | 14, ['G'] = DIGIT_FLAG | 15,
+        ['H'] = DIGIT_FLAG | 16, ['J'] = DIGIT_FLAG | 17, ['K'] = DIGIT_FLAG | 18, ['L'] = DIGIT_FLAG | 19,
+        ['M'] = DIGIT_FLAG | 20, ['4'] = DIGIT_FLAG | 21, ['P'] = DIGIT_FLAG | 22, ['Q'] = DIGIT_FLAG | 23,
+        ['R'] = DIGIT_FLAG | 24, ['S'] = DIGIT_FLAG | 25, ['T'] = DIGIT_FLAG | 26, ['7'] = DIGIT_FLAG | 27,
+        ['V'] = DIGIT_FLAG | 28, ['W'] = DIGIT_FLAG | 29, ['X'] = DIGIT_FLAG | 30, ['Y'] = DIGIT_FLAG | 31,
+        ['Z'] = DIGIT_FLAG | 32, ['2'] = DIGIT_FLAG | 33, ['b'] = DIGIT_FLAG | 34, ['c'] = DIGIT_FLAG | 35,
+        ['d'] = DIGIT_FLAG | 36, ['e'] = DIGIT_FLAG | 37, ['C'] = DIGIT_FLAG | 38, ['g'] = DIGIT_FLAG | 39,
+        ['6'] = DIGIT_FLAG | 40, ['5'] = DIGIT_FLAG | 41, ['j'] = DIGIT_FLAG | 42, ['k'] = DIGIT_FLAG | 43,
+        ['m'] = DIGIT_FLAG | 44, ['8'] = DIGIT_FLAG | 45, ['o'] = DIGIT_FLAG | 46, ['F'] = DIGIT_FLAG | 47,
+        ['q'] = DIGIT_FLAG | 48, ['i'] = DIGIT_FLAG | 49, ['1'] = DIGIT_FLAG | 50, ['t'] = DIGIT_FLAG | 51,
+        ['u'] = DIGIT_FLAG | 52, ['v'] = DIGIT_FLAG | 53, ['A'] = DIGIT_FLAG | 54, ['x'] = DIGIT_FLAG | 55,
+        ['y'] = DIGIT_FLAG | 56, ['z'] = DIGIT_FLAG | 57,
+};
+
+static const unsigned char flickr_table[256] = {
+        SPACE_ENTRIES,
+        ['1'] = DIGIT_FLAG | 0, ['2'] = DIGIT_FLAG | 1, ['3'] = DIGIT_FLAG | 2, ['4'] = DIGIT_FLAG | 3,
+        ['5'] = DIGIT_FLAG | 4, ['6'] = DIGIT_FLAG | 5, ['7'] = DIGIT_FLAG | 6, ['8'] = DIGIT_FLAG | 7,
+        ['9'] = DIGIT_FLAG | 8, ['a'] = DIGIT_FLAG | 9, ['b'] = DIGIT_FLAG | 10, ['c'] = DIGIT_FLAG | 11,
+        ['d'] = DIGIT_FLAG | 12, ['e'] = DIGIT_FLAG | 13, ['f'] = DIGIT_FLAG | 14, ['g'] = DIGIT_FLAG | 15,
+        ['h'] = DIGIT_FLAG | 16, ['i'] = DIGIT_FLAG | 17, ['j'] = DIGIT_FLAG | 18, ['k'] = DIGIT_FLAG | 19,
+        ['m'] = DIGIT_FLAG | 20, ['n'] = DIGIT_FLAG | 21, ['o'] = DIGIT_FLAG | 22, ['p'] = DIGIT_FLAG | 23,
+        ['q'] = DIGIT_FLAG | 24, ['r'] = DIGIT_FLAG | 25, ['s'] = DIGIT_FLAG | 26, ['t'] = DIGIT_FLAG | 27,
+        ['u'] = DIGIT_FLAG | 28, ['v'] = DIGIT_FLAG | 29, ['w'] = DIGIT_FLAG | 30, ['x'] = DIGIT_FLAG | 31,
+        ['y'] = DIGIT_FLAG | 32, ['z'] = DIGIT_FLAG | 33, ['A'] = DIGIT_FLAG | 34, ['B'] = DIGIT_FLAG | 35,
+        ['C'] = DIGIT_FLAG | 36, ['D'] = DIGIT_FLAG | 37, ['E'] = DIGIT_FLAG | 38, ['F'] = DIGIT_FLAG | 39,
+        ['G'] = DIGIT_FLAG | 40, ['H'] = DIGIT_FLAG | 41, ['J'] = DIGIT_FLAG | 42, ['K'] = DIGIT_FLAG | 43,
+        ['L'] = DIGIT_FLAG | 44, ['M'] = DIGIT_FLAG | 45, ['N'] = DIGIT_FLAG | 46, ['P'] = DIGIT_FLAG | 47,
+        ['Q'] = DIGIT_FLAG | 48, ['R'] = DIGIT_FLAG | 49, ['S'] = DIGIT_FLAG | 50, ['T'] = DIGIT_FLAG | 51,
+        ['U'] = DIGIT_FLAG | 52, ['V'] = DIGIT_FLAG | 53, ['W'] = DIGIT_FLAG | 54, ['X'] = DIGIT_FLAG | 55,
+        ['Y'] = DIGIT_FLAG | 56, ['Z'] = DIGIT_FLAG | 57,
+};
+
+/*
+ * Group kernels: an encode kernel transforms groups of bytes into digits,
+ * a decode kernel transforms digit values (not characters) into bytes.
+ * Decode kernels return the number of groups decoded, they stop before
+ * the first group which does not fit into its bytes.
+ */
+typedef char *(*encode_kernel)(const unsigned char *in, size_t groups, char *out);
+typedef size_t (*decode_kernel)(const unsigned char *digits, size_t groups, unsigned char **out);
+
+struct b58_codec
+{
+    const char *name;
+    size_t group_bytes;
+    size_t group_digits;
+    const char *alphabet;
+    const unsigned char *table;
+
+    encode_kernel encode;
+    decode_kernel decode;
+    /* used for single groups, which are not worth a SIMD kernel */
+    encode_kernel encode_scalar;
+};
+
+#if defined(__GNUC__)
+#define UNROLL _Pragma("GCC unroll 16")
+#else
+#define UNROLL
+#endif
+
+/* the largest value of a group of bytes */
+#define GROUP_MAXIMUM(bytes) (UINT64_MAX >> (64 - 8 * (bytes)))
+
+/*
+ * Every kernel is specialized for one alphabet and one group width,
+ * all loops have constant bounds and are unrolled.
+ */
+#define DEFINE_ENCODE_KERNEL(name, bytes, digits) \
+    static char *encode_##name##_##bytes(const unsigned char *in, size_t groups, char *out) { \
+        for (size_t group = 0; group < groups; group++, in += (bytes), out += (digits)) { \
+            uint64_t number = 0; \
+            UNROLL for (int i = 0; i < (bytes); i++) { number = (number << 8) | in[i]; } \
+            UNROLL for (int i = (digits) - 1; i >= 0; i--) { \
+                out[i] = name##_alphabet[number % 58]; \
+                number /= 58; \
+            } \
+        } \
+        return out; \
+    }
+
+/*
+ * Bytes of the group are written up to the first zero byte, which is what
+ * the original printf("%s") output did (and what drops the padding).
+ * 58^10 still fits into 64 bits, only the 11th digit needs an overflow check.
+ */
+#define DEFINE_DECODE_KERNEL(bytes, digits) \
+    static size_t decode_##bytes(const unsigned char *digits_in, size_t groups, unsigned char **out) { \
+        for (size_t group = 0; group < groups; group++, digits_in += (digits)) { \
+            uint64_t number = 0; \
+            UNROLL for (int i = 0; i < (digits); i++) { \
+                if (i == 10 && number > (UINT64_MAX - digits_in[i]) / 58) { return group; } \
+                number = number * 58 + digits_in[i]; \
+            } \
+            if (number > GROUP_MAXIMUM(bytes)) { return group; } \
+            UNROLL for (int i = (bytes) - 1; i >= 0; i--) { \
+                unsigned char byte = (unsigned char) ((number >> (8 * i)) & 0xff); \
+                if (byte == 0) { break; } \
+                *(*out)++ = byte; \
+            } \
+        } \
+        return groups; \
+    }
+
+/* supported group widths, bytes -> digits */
+#define DEFINE_ENCODE_KERNELS(name) \
+    DEFINE_ENCODE_KERNEL(name, 1, 2) \
+    DEFINE_ENCODE_KERNEL(name, 2, 3) \
+    DEFINE_ENCODE_KERNEL(name, 4, 6) \
+    DEFINE_ENCODE_KERNEL(name, 8, 11)
+
+DEFINE_ENCODE_KERNELS(bitcoin)
+DEFINE_ENCODE_KERNELS(ripple)
+DEFINE_ENCODE_KERNELS(flickr)
+
+DEFINE_DECODE_KERNEL(1, 2)
+DEFINE_DECODE_KERNEL(2, 3)
+DEFINE_DECODE_KERNEL(4, 6)
+DEFINE_DECODE_KERNEL(8, 11)
+
+/*
+ * Compaction stores digit values of the input, skipping whitespace, and
+ * stops at the first invalid byte. It does not depend on the group width,
+ * only on the reverse lookup table of the alphabet.
+ */
+typedef size_t (*compact_kernel)(const unsigned char *table, const char *in, size_t length, unsigned char *digits,
+                                 size_t *count);
+
+static size_t compact_scalar(const unsigned char *table, const char *in, size_t length, unsigned char *digits,
+                             size_t *count) {
+    size_t stored = 0, index = 0;
+    for (; index < length; index++) {
+        unsigned char class = table[(unsigned char) in[index]];
+        if (class & SPACE_FLAG) { continue; }
+        if (!class) { break; }
+        digits[stored++] = class & DIGIT_MASK;
+    }
+    *count = stored;
+    return index;
+}
+
+static compact_kernel compact = compact_scalar;
+
+#define CODEC(name, bytes, digits) \
+    {#name, (bytes), (digits), name##_alphabet, name##_table, \
+     encode_##name##_##bytes, decode_##bytes, encode_##name##_##bytes}
+
+#define CODECS(name) \
+    {CODEC(name, 1, 2), CODEC(name, 2, 3), CODEC(name, 4, 6), CODEC(name, 8, 11)}
+
+enum { ALPHABETS = 3, WIDTHS = 4, WIDTH_4 = 2 };
+
+/* not const, b58_select_backend() swaps the kernels of 4-byte groups */
+static struct b58_codec codecs[ALPHABETS][WIDTHS] = {CODECS(bitcoin), CODECS(ripple), CODECS(flickr)};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+/*
+ * x / 58 for any 32-bit x is (x * RECIPROCAL_58) >> 37, the product is
+ * formed by _mm_mul_epu32() separately for even and odd 32-bit lanes.
+ */
+#define RECIPROCAL_58 2369637129u
+
+/* stores the low 12 bytes, the last store of a kernel must not run over */
+#define STORE_12(out, vector) \
+    do { \
+        _mm_storel_epi64((__m128i *) (out), (vector)); \
+        uint32_t last = (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128((vector), 8)); \
+        memcpy((out) + 8, &last, 4); \
+    } while (0)
+
+/* big-endian 32-bit groups <-> native lanes */
+#define BYTE_SWAP_32 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+/* [6 chars, 2 unused] x 2 -> 12 consecutive chars */
+#define PACK_12 0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1
+/* 12 digits -> [6 digits, 0, 0] x 2, from the start or the end of 16 loaded bytes */
+#define SPREAD_12 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1
+#define SPREAD_12_END 4, 5, 6, 7, 8, 9, -1, -1, 10, 11, 12, 13, 14, 15, -1, -1
+/* value in low half of each 64-bit lane -> 4 big-endian bytes */
+#define VALUE_TO_BYTES 3, 2, 1, 0, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1
+
+__attribute__((target("sse4.1")))
+static __m128i div58_sse(__m128i x) {
+    const __m128i reciprocal = _mm_set1_epi32((int) RECIPROCAL_58);
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(x, reciprocal), 37);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), reciprocal), 37);
+    return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xcc);
+}
+
+__attribute__((target("sse4.1")))
+static __m128i digits_to_chars_sse(const __m128i tables[4], __m128i digits) {
+    __m128i result = _mm_shuffle_epi8(tables[0], digits);
+    result = _mm_blendv_epi8(result, _mm_shuffle_epi8(tables[1], digits), _mm_cmpgt_epi8(digits, _mm_set1_epi8(15)));
+    result = _mm_blendv_epi8(result, _mm_shuffle_epi8(tables[2], digits), _mm_cmpgt_epi8(digits, _mm_set1_epi8(31)));
+    return _mm_blendv_epi8(result, _mm_shuffle_epi8(tables[3], digits), _mm_cmpgt_epi8(digits, _mm_set1_epi8(47)));
+}
+
+/*
+ * The SIMD kernels take the alphabet and the scalar kernel for the
+ * remaining groups, the wrappers below bind them per alphabet.
+ */
+__attribute__((target("sse4.1")))
+static inline char *encode_sse41(const char *alphabet, encode_kernel scalar, const unsigned char *in, size_t groups,
+                                 char *out) {
+    const __m128i byte_swap = _mm_setr_epi8(BYTE_SWAP_32);
+    const __m128i pack = _mm_setr_epi8(PACK_12);
+    const __m128i base = _mm_set1_epi32(58);
+    __m128i tables[4];
+    for (int i = 0; i < 4; i++) { tables[i] = _mm_loadu_si128((const __m128i *) alphabet + i); }
+    size_t group = 0;
+    for (; group + 4 <= groups; group += 4, in += 16, out += 24) {
+        __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) in), byte_swap);
+        __m128i digit[6];
+        for (int i = 5; i >= 0; i--) {
+            __m128i quotient = div58_sse(x);
+            digit[i] = _mm_sub_epi32(x, _mm_mullo_epi32(quotient, base));
+            x = quotient;
+        }
+        __m128i low = _mm_or_si128(_mm_or_si128(digit[0], _mm_slli_epi32(digit[1], 8)),
+                                   _mm_or_si128(_mm_slli_epi32(digit[2], 16), _mm_slli_epi32(digit[3], 24)));
+        __m128i high = _mm_or_si128(digit[4], _mm_slli_epi32(digit[5], 8));
+        low = digits_to_chars_sse(tables, low);
+        high = digits_to_chars_sse(tables, high);
+        _mm_storeu_si128((__m128i *) out, _mm_shuffle_epi8(_mm_unpacklo_epi32(low, high), pack));
+        STORE_12(out + 12, _mm_shuffle_epi8(_mm_unpackhi_epi32(low, high), pack));
+    }
+    return scalar(in, groups - group, out);
+}
+
+/*
+ * Two groups of 6 digits in [6 digits, 0, 0] 64-bit lanes into their values:
+ * maddubs forms 2-digit pairs, madd the first 4 digits and mul_epu32 the
+ * rest in 64 bits, so that an overflow of 32 bits stays visible.
+ */
+__attribute__((target("sse4.1")))
+static __m128i digits_to_values_sse(__m128i digits) {
+    __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(58, 1, 58, 1, 58, 1, 0, 0, 58, 1, 58, 1, 58, 1, 0, 0));
+    __m128i parts = _mm_madd_epi16(pairs, _mm_setr_epi16(58 * 58, 1, 1, 0, 58 * 58, 1, 1, 0));
+    return _mm_add_epi64(_mm_mul_epu32(parts, _mm_set1_epi32(58 * 58)), _mm_srli_epi64(parts, 32));
+}
+
+__attribute__((target("sse4.1")))
+static size_t decode_4_sse41(const unsigned char *digits, size_t groups, unsigned char **out) {
+    const __m128i spread = _mm_setr_epi8(SPREAD_12);
+    const __m128i spread_end = _mm_setr_epi8(SPREAD_12_END);
+    const __m128i to_bytes = _mm_setr_epi8(VALUE_TO_BYTES);
+    size_t group = 0;
+    for (; group + 4 <= groups; group += 4, digits += 24) {
+        __m128i first = digits_to_values_sse(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) digits), spread));
+        __m128i second = digits_to_values_sse(
+                _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (digits + 8)), spread_end));
+        __m128i overflow = _mm_or_si128(_mm_srli_epi64(first, 32), _mm_srli_epi64(second, 32));
+        __m128i bytes = _mm_unpacklo_epi64(_mm_shuffle_epi8(first, to_bytes), _mm_shuffle_epi8(second, to_bytes));
+        if (!_mm_testz_si128(overflow, overflow)
+            || _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()))) {
+            size_t done = decode_4(digits, 4, out);
+            if (done != 4) { return group + done; }
+            continue;
+        }
+        _mm_storeu_si128((__m128i *) *out, bytes);
+        *out += 16;
+    }
+    return group + decode_4(digits, groups - group, out);
+}
+
+__attribute__((target("avx2")))
+static __m256i div58_avx2(__m256i x) {
+    const __m256i reciprocal = _mm256_set1_epi32((int) RECIPROCAL_58);
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(x, reciprocal), 37);
+    __m256i odd = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), reciprocal), 37);
+    return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+}
 
-uint64_t power(uint64_t base, uint8_t exponent) {
-    uint64_t result = 1;
-    while (exponent > 0) {
-        if (exponent % 2 == 1) { result *= base; }
-        base *= base;
-        exponent /= 2;
+__attribute__((target("avx2")))
+static __m256i digits_to_chars_avx2(const __m256i tables[4], __m256i digits) {
+    __m256i result = _mm256_shuffle_epi8(tables[0], digits);
+    for (int i = 1; i < 4; i++) {
+        result = _mm256_blendv_epi8(result, _mm256_shuffle_epi8(tables[i], digits),
+                                    _mm256_cmpgt_epi8(digits, _mm256_set1_epi8((char) (16 * i - 1))));
     }
     return result;
 }
 
-void dec_to_base58(uint64_t number) {
-    char result[7] = {0};
-    for (int i = 5; i >= 0; i--) {
-        result[i] = BASE58[number % 58];
-        number /= 58;
+__attribute__((target("avx2")))
+static inline char *encode_avx2(const char *alphabet, encode_kernel scalar, const unsigned char *in, size_t groups,
+                                char *out) {
+    const __m256i byte_swap = _mm256_setr_epi8(BYTE_SWAP_32, BYTE_SWAP_32);
+    const __m256i pack = _mm256_setr_epi8(PACK_12, PACK_12);
+    const __m256i base = _mm256_set1_epi32(58);
+    __m256i tables[4];
+    for (int i = 0; i < 4; i++) {
+        tables[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) alphabet + i));
     }
-    printf("%s", result);
+    size_t group = 0;
+    for (; group + 8 <= groups; group += 8, in += 32, out += 48) {
+        __m256i x = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) in), byte_swap);
+        __m256i digit[6];
+        for (int i = 5; i >= 0; i--) {
+            __m256i quotient = div58_avx2(x);
+            digit[i] = _mm256_sub_epi32(x, _mm256_mullo_epi32(quotient, base));
+            x = quotient;
+        }
+        __m256i low = _mm256_or_si256(_mm256_or_si256(digit[0], _mm256_slli_epi32(digit[1], 8)),
+                                      _mm256_or_si256(_mm256_slli_epi32(digit[2], 16),
+                                                      _mm256_slli_epi32(digit[3], 24)));
+        __m256i high = _mm256_or_si256(digit[4], _mm256_slli_epi32(digit[5], 8));
+        low = digits_to_chars_avx2(tables, low);
+        high = digits_to_chars_avx2(tables, high);
+        /* groups 0 1 | 4 5 and 2 3 | 6 7 */
+        __m256i even = _mm256_shuffle_epi8(_mm256_unpacklo_epi32(low, high), pack);
+        __m256i odd = _mm256_shuffle_epi8(_mm256_unpackhi_epi32(low, high), pack);
+        _mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(even));
+        _mm_storeu_si128((__m128i *) (out + 12), _mm256_castsi256_si128(odd));
+        _mm_storeu_si128((__m128i *) (out + 24), _mm256_extracti128_si256(even, 1));
+        STORE_12(out + 36, _mm256_extracti128_si256(odd, 1));
+    }
+    return scalar(in, groups - group, out);
 }
 
-void dec_to_ascii(uint64_t number) {
-    char result[5] = {0};
-    for (int i = 3; i >= 0; i--) {
-        result[i] = (char) (number % 256);
-        number /= 256;
+__attribute__((target("avx2")))
+static __m256i load_spread_avx2(const unsigned char *digits) {
+    const __m256i spread = _mm256_setr_epi8(SPREAD_12, SPREAD_12_END);
+    __m256i both = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) digits)),
+                                           _mm_loadu_si128((const __m128i *) (digits + 8)), 1);
+    return _mm256_shuffle_epi8(both, spread);
+}
+
+__attribute__((target("avx2")))
+static __m256i digits_to_values_avx2(__m256i digits) {
+    __m256i pairs = _mm256_maddubs_epi16(digits, _mm256_setr_epi8(58, 1, 58, 1, 58, 1, 0, 0, 58, 1, 58, 1, 58, 1, 0, 0,
+                                                                  58, 1, 58, 1, 58, 1, 0, 0, 58, 1, 58, 1, 58, 1, 0,
+                                                                  0));
+    __m256i parts = _mm256_madd_epi16(pairs, _mm256_setr_epi16(58 * 58, 1, 1, 0, 58 * 58, 1, 1, 0,
+                                                               58 * 58, 1, 1, 0, 58 * 58, 1, 1, 0));
+    return _mm256_add_epi64(_mm256_mul_epu32(parts, _mm256_set1_epi32(58 * 58)), _mm256_srli_epi64(parts, 32));
+}
+
+__attribute__((target("avx2")))
+static size_t decode_4_avx2(const unsigned char *digits, size_t groups, unsigned char **out) {
+    const __m256i to_bytes = _mm256_setr_epi8(VALUE_TO_BYTES, VALUE_TO_BYTES);
+    size_t group = 0;
+    for (; group + 8 <= groups; group += 8, digits += 48) {
+        /* groups 0 1 | 2 3 and 4 5 | 6 7 */
+        __m256i first = digits_to_values_avx2(load_spread_avx2(digits));
+        __m256i second = digits_to_values_avx2(load_spread_avx2(digits + 24));
+        __m256i overflow = _mm256_or_si256(_mm256_srli_epi64(first, 32), _mm256_srli_epi64(second, 32));
+        __m256i bytes = _mm256_permute4x64_epi64(
+                _mm256_unpacklo_epi64(_mm256_shuffle_epi8(first, to_bytes), _mm256_shuffle_epi8(second, to_bytes)),
+                0xd8);
+        if (!_mm256_testz_si256(overflow, overflow)
+            || _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256()))) {
+            size_t done = decode_4(digits, 8, out);
+            if (done != 8) { return group + done; }
+            continue;
+        }
+        _mm256_storeu_si256((__m256i *) *out, bytes);
+        *out += 32;
     }
-    printf("%s", result);
+    return group + decode_4(digits, groups - group, out);
 }
 
-bool encode() {
-    uint64_t my_number = 0;
-    int ch, count = 0;
-    while ((ch = getchar()) != EOF) {
-        my_number <<= 8;
-        my_number |= ch;
-        count++;
-        if (count == 4) {
-            dec_to_base58(my_number);
-            count = 0;
-            my_number = 0;
+#define DEFINE_SIMD_KERNELS(name) \
+    __attribute__((target("sse4.1"))) \
+    static char *encode_##name##_sse41(const unsigned char *in, size_t groups, char *out) { \
+        return encode_sse41(name##_alphabet, encode_##name##_4, in, groups, out); \
+    } \
+    __attribute__((target("avx2"))) \
+    static char *encode_##name##_avx2(const unsigned char *in, size_t groups, char *out) { \
+        return encode_avx2(name##_alphabet, encode_##name##_4, in, groups, out); \
+    }
+
+DEFINE_SIMD_KERNELS(bitcoin)
+DEFINE_SIMD_KERNELS(ripple)
+DEFINE_SIMD_KERNELS(flickr)
+
+/*
+ * Compaction classifies 16 or 32 bytes at once. The reverse lookup table
+ * is split into 8 pshufb tables by the high nibble, bytes above 0x7f match
+ * none of them and come out invalid. Whitespace is squeezed out 8 bytes at
+ * a time by shuffle patterns indexed by the whitespace mask.
+ *
+ * Stores may write up to 8 (or 16, 32) bytes past the compacted digits,
+ * which is safe, the output never gets ahead of the input.
+ */
+static unsigned char COMPACT_PATTERNS[256][8];
+
+static void build_compact_patterns(void) {
+    for (int mask = 0; mask < 256; mask++) {
+        int used = 0;
+        for (int i = 0; i < 8; i++) {
+            if (!(mask & (1 << i))) { COMPACT_PATTERNS[mask][used++] = (unsigned char) i; }
         }
+        while (used < 8) { COMPACT_PATTERNS[mask][used++] = 0x80; }
     }
-    if (count != 0) {
-        my_number <<= 8 * (4 - count);
-        dec_to_base58(my_number);
+}
+
+__attribute__((target("sse4.1")))
+static __m128i classify_sse(const __m128i tables[8], __m128i bytes) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i low = _mm_and_si128(bytes, nibble);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+    __m128i class = _mm_setzero_si128();
+    for (int i = 0; i < 8; i++) {
+        __m128i hit = _mm_cmpeq_epi8(high, _mm_set1_epi8((char) i));
+        class = _mm_or_si128(class, _mm_and_si128(hit, _mm_shuffle_epi8(tables[i], low)));
     }
-    printf("\n");
+    return class;
+}
+
+__attribute__((target("sse4.1")))
+static unsigned char *squeeze_16_sse(__m128i values, unsigned spaces, unsigned char *out) {
+    __m128i pattern = _mm_loadl_epi64((const __m128i *) COMPACT_PATTERNS[spaces & 0xff]);
+    _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi8(values, pattern));
+    out += 8 - __builtin_popcount(spaces & 0xff);
+    pattern = _mm_loadl_epi64((const __m128i *) COMPACT_PATTERNS[(spaces >> 8) & 0xff]);
+    _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi8(values, _mm_add_epi8(pattern, _mm_set1_epi8(8))));
+    return out + 8 - __builtin_popcount((spaces >> 8) & 0xff);
+}
+
+__attribute__((target("sse4.1")))
+static size_t compact_sse41(const unsigned char *table, const char *in, size_t length, unsigned char *digits,
+                            size_t *count) {
+    __m128i tables[8];
+    for (int i = 0; i < 8; i++) { tables[i] = _mm_loadu_si128((const __m128i *) table + i); }
+    unsigned char *out = digits;
+    size_t index = 0, rest;
+    for (; index + 16 <= length; index += 16) {
+        __m128i class = classify_sse(tables, _mm_loadu_si128((const __m128i *) (in + index)));
+        /* the scalar loop below finds the invalid byte */
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(class, _mm_setzero_si128()))) { break; }
+        unsigned spaces = (unsigned) _mm_movemask_epi8(class);
+        __m128i values = _mm_and_si128(class, _mm_set1_epi8(DIGIT_MASK));
+        if (spaces == 0) {
+            _mm_storeu_si128((__m128i *) out, values);
+            out += 16;
+        } else {
+            out = squeeze_16_sse(values, spaces, out);
+        }
+    }
+    index += compact_scalar(table, in + index, length - index, out, &rest);
+    *count = (size_t) (out - digits) + rest;
+    return index;
+}
+
+__attribute__((target("avx2")))
+static size_t compact_avx2(const unsigned char *table, const char *in, size_t length, unsigned char *digits,
+                           size_t *count) {
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i tables[8];
+    for (int i = 0; i < 8; i++) {
+        tables[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) table + i));
+    }
+    unsigned char *out = digits;
+    size_t index = 0, rest;
+    for (; index + 32 <= length; index += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *) (in + index));
+        __m256i low = _mm256_and_si256(bytes, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        __m256i class = _mm256_setzero_si256();
+        for (int i = 0; i < 8; i++) {
+            __m256i hit = _mm256_cmpeq_epi8(high, _mm256_set1_epi8((char) i));
+            class = _mm256_or_si256(class, _mm256_and_si256(hit, _mm256_shuffle_epi8(tables[i], low)));
+        }
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(class, _mm256_setzero_si256()))) { break; }
+        unsigned spaces = (unsigned) _mm256_movemask_epi8(class);
+        __m256i values = _mm256_and_si256(class, _mm256_set1_epi8(DIGIT_MASK));
+        if (spaces == 0) {
+            _mm256_storeu_si256((__m256i *) out, values);
+            out += 32;
+        } else {
+            out = squeeze_16_sse(_mm256_castsi256_si128(values), spaces & 0xffff, out);
+            out = squeeze_16_sse(_mm256_extracti128_si256(values, 1), spaces >> 16, out);
+        }
+    }
+    index += compact_scalar(table, in + index, length - index, out, &rest);
+    *count = (size_t) (out - digits) + rest;
+    return index;
+}
+
+#define HAVE_X86_KERNELS
+#endif
+
+/* ************************************************************** *
+ *                            Backends                            *
+ * ************************************************************** */
+
+static enum b58_backend selected_backend = b58_backend_scalar;
+
+/*
+ * Only 4-byte groups have SIMD group kernels, the other widths always run
+ * the scalar ones. Compaction is shared by all codecs.
+ */
+bool b58_select_backend(enum b58_backend backend) {
+    encode_kernel encode[ALPHABETS] = {encode_bitcoin_4, encode_ripple_4, encode_flickr_4};
+    decode_kernel decode = decode_4;
+    compact_kernel compact_digits = compact_scalar;
+#ifdef HAVE_X86_KERNELS
+    if (backend == b58_backend_avx2 && __builtin_cpu_supports("avx2")) {
+        encode[0] = encode_bitcoin_avx2;
+        encode[1] = encode_ripple_avx2;
+        encode[2] = encode_flickr_avx2;
+        decode = decode_4_avx2;
+        compact_digits = compact_avx2;
+    } else if (backend == b58_backend_sse41 && __builtin_cpu_supports("sse4.1")) {
+        encode[0] = encode_bitcoin_sse41;
+        encode[1] = encode_ripple_sse41;
+        encode[2] = encode_flickr_sse41;
+        decode = decode_4_sse41;
+        compact_digits = compact_sse41;
+    } else if (backend != b58_backend_scalar) {
+        return false;
+    }
+#else
+    if (backend != b58_backend_scalar) { return false; }
+#endif
+    for (int i = 0; i < ALPHABETS; i++) {
+        codecs[i][WIDTH_4].encode = encode[i];
+        codecs[i][WIDTH_4].decode = decode;
+    }
+    compact = compact_digits;
+    selected_backend = backend;
     return true;
 }
 
-bool decode() {
-    uint64_t my_number = 0;
-    int ch, count = 0;
-    while ((ch = getchar()) != EOF) {
-        const char *pointer = strchr(BASE58, ch);
-        if (!isspace(ch) && !pointer) { return false; }
-        if (!isspace(ch) && pointer) {
-            my_number += power(58, 5 - count) * (int) (pointer - BASE58);
-            count++;
-            if (count == 6 && my_number > MAXIMUM) { return false; }
-            if (count == 6) {
-                dec_to_ascii(my_number);
-                count = 0;
-                my_number = 0;
+enum b58_backend b58_selected_backend(void) {
+    return selected_backend;
+}
+
+const char *b58_backend_name(enum b58_backend backend) {
+    static const char *const NAMES[] = {"scalar", "sse4.1", "avx2"};
+    return NAMES[backend];
+}
+
+#ifdef HAVE_X86_KERNELS
+/*
+ * Picks the widest kernels the CPU supports before main() runs,
+ * the output is the same for all of them.
+ */
+__attribute__((constructor))
+static void select_kernels(void) {
+    __builtin_cpu_init();
+    build_compact_patterns();
+    if (!b58_select_backend(b58_backend_avx2)) { b58_select_backend(b58_backend_sse41); }
+}
+#endif
+
+/* ************************************************************** *
+ *                             Codecs                             *
+ * ************************************************************** */
+
+const b58_codec *b58_codec_default(void) {
+    return &codecs[0][WIDTH_4];
+}
+
+const b58_codec *b58_codec_find(const char *alphabet, size_t group_bytes) {
+    for (int i = 0; i < ALPHABETS; i++) {
+        for (int j = 0; j < WIDTHS; j++) {
+            if (!strcmp(codecs[i][j].name, alphabet) && codecs[i][j].group_bytes == group_bytes) {
+                return &codecs[i][j];
             }
         }
     }
-    return (count == 0);
+    return NULL;
+}
+
+const char *b58_codec_alphabet(const b58_codec *codec) {
+    return codec->name;
+}
+
+size_t b58_codec_group_bytes(const b58_codec *codec) {
+    return codec->group_bytes;
+}
+
+size_t b58_codec_group_digits(const b58_codec *codec) {
+    return codec->group_digits;
+}
+
+/* ************************************************************** *
+ *                           Block API                            *
+ * ************************************************************** */
+
+size_t b58_encode_groups(const b58_codec *codec, const unsigned char *in, size_t groups, char *out) {
+    return (size_t) (codec->encode(in, groups, out) - out);
+}
+
+size_t b58_compact(const b58_codec *codec, const char *in, size_t length, unsigned char *digits, size_t *count) {
+    return compact(codec->table, in, length, digits, count);
+}
+
+size_t b58_decode_groups(const b58_codec *codec, const unsigned char *digits, size_t groups, unsigned char *out,
+                         size_t *written) {
+    unsigned char *end = out;
+    size_t done = codec->decode(digits, groups, &end);
+    *written = (size_t) (end - out);
+    return done;
+}
+
+size_t b58_digit_offset(const b58_codec *codec, const char *in, size_t digit) {
+    size_t index = 0;
+    for (;; index++) {
+        if ((codec->table[(unsigned char) in[index]] & DIGIT_FLAG) && digit-- == 0) { return index; }
+    }
+}
+
+/* ************************************************************** *
+ *                        Incremental API                         *
+ * ************************************************************** */
+
+void b58_encode_init(b58_encoder *encoder, const b58_codec *codec) {
+    encoder->codec = codec;
+    encoder->carried = 0;
+}
+
+size_t b58_encode_update_size(const b58_encoder *encoder, size_t length) {
+    const b58_codec *codec = encoder->codec;
+    return (encoder->carried + length) / codec->group_bytes * codec->group_digits;
+}
+
+size_t b58_encode_update(b58_encoder *encoder, const void *data, size_t length, char *out) {
+    const b58_codec *codec = encoder->codec;
+    size_t bytes = codec->group_bytes;
+    const unsigned char *in = data;
+    char *end = out;
+    if (encoder->carried > 0) {
+        size_t take = (length < bytes - encoder->carried) ? length : bytes - encoder->carried;
+        memcpy(encoder->carry + encoder->carried, in, take);
+        encoder->carried += take;
+        in += take;
+        length -= take;
+        if (encoder->carried < bytes) { return 0; }
+        end = codec->encode_scalar(encoder->carry, 1, end);
+        encoder->carried = 0;
+    }
+    end = codec->encode(in, length / bytes, end);
+    encoder->carried = length % bytes;
+    memcpy(encoder->carry, in + length - encoder->carried, encoder->carried);
+    return (size_t) (end - out);
+}
+
+size_t b58_encode_final_size(const b58_encoder *encoder) {
+    return (encoder->carried > 0) ? encoder->codec->group_digits : 0;
+}
+
+size_t b58_encode_final(b58_encoder *encoder, char *out) {
+    const b58_codec *codec = encoder->codec;
+    if (encoder->carried == 0) { return 0; }
+    memset(encoder->carry + encoder->carried, 0, codec->group_bytes - encoder->carried);
+    codec->encode_scalar(encoder->carry, 1, out);
+    encoder->carried = 0;
+    return codec->group_digits;
+}
+
+size_t b58_encoded_size(const b58_codec *codec, size_t length) {
+    return (length + codec->group_bytes - 1) / codec->group_bytes * codec->group_digits;
+}
+
+void b58_decode_init(b58_decoder *decoder, const b58_codec *codec) {
+    decoder->codec = codec;
+    decoder->carried = 0;
+    decoder->offset = 0;
+    decoder->error_offset = 0;
+}
+
+size_t b58_decode_update_size(const b58_decoder *decoder, size_t length) {
+    const b58_codec *codec = decoder->codec;
+    return (decoder->carried + length) / codec->group_digits * codec->group_bytes;
+}
+
+/*
+ * The input is compacted into digit values on the stack in blocks of
+ * DECODE_BLOCK characters, the incomplete group is carried over.
+ */
+#define DECODE_BLOCK 4096
+
+bool b58_decode_update(b58_decoder *decoder, const char *in, size_t length, unsigned char *out, size_t *written) {
+    const b58_codec *codec = decoder->codec;
+    size_t width = codec->group_digits;
+    unsigned char digits[DECODE_BLOCK + B58_MAX_GROUP_DIGITS];
+    unsigned char *end = out;
+    for (size_t done = 0; done < length;) {
+        size_t block = (length - done < DECODE_BLOCK) ? length - done : DECODE_BLOCK;
+        size_t carried = decoder->carried, count;
+        memcpy(digits, decoder->carry, carried);
+        size_t invalid = b58_compact(codec, in + done, block, digits + carried, &count);
+        count += carried;
+        size_t groups = count / width;
+        size_t decoded = codec->decode(digits, groups, &end);
+        *written = (size_t) (end - out);
+        if (decoded != groups) {
+            size_t digit = decoded * width + width - 1 - carried;
+            decoder->error_offset = decoder->offset + done + b58_digit_offset(codec, in + done, digit);
+            return false;
+        }
+        if (invalid != block) {
+            decoder->error_offset = decoder->offset + done + invalid;
+            return false;
+        }
+        decoder->carried = count - groups * width;
+        memcpy(decoder->carry, digits + groups * width, decoder->carried);
+        done += block;
+    }
+    decoder->offset += length;
+    *written = (size_t) (end - out);
+    return true;
 }
 
-int main(int argc, char **argv) {
-    if ((argc == 1) || (argc == 2 && !strcmp(argv[1], "-e"))) {
-        encode();
-    } else if (argc == 2 && !strcmp(argv[1], "-d")) {
-        if (!decode()) {
-            fprintf(stderr, "Input isn't encoded via Base58!\n");
-            return EXIT_FAILURE;
+bool b58_decode_final(b58_decoder *decoder) {
+    decoder->error_offset = decoder->offset;
+    return decoder->carried == 0;
+}
+
+size_t b58_decoded_size(const b58_codec *codec, size_t length) {
+    return length / codec->group_digits * codec->group_bytes;
+}
+
+/* ************************************************************** *
+ *                       Whole-buffer codec                       *
+ * ************************************************************** */
+
+/*
+ * Encoding keeps the number in limbs of radix 58^5 (least significant
+ * first), so every limb gives exactly 5 digits. Input is consumed 32 bits
+ * at a time, t = limb * 2^32 + carry stays below 2^63. Decoding works the
+ * other way round, limbs of radix 2^32 take 5 digits at a time.
+ */
+#define LIMB_RADIX 656356768u /* 58^5 */
+
+size_t b58_bignum_limbs(size_t length) {
+    return length / 3 + 2;
+}
+
+size_t b58_bignum_encoded_size(size_t length) {
+    return length * 138 / 100 + 1;
+}
+
+size_t b58_bignum_decoded_size(size_t length) {
+    return length;
+}
+
+/*
+ * The input is the concatenation of head and tail, which saves copying
+ * the payload next to its checksum.
+ */
+static size_t bignum_encode(const b58_codec *codec, const unsigned char *head, size_t head_length, const unsigned char *tail,
+                            size_t tail_length, uint32_t *limbs, char *out) {
+    const char *alphabet = codec->alphabet;
+    size_t length = head_length + tail_length, zeros = 0, used = 0;
+#define BYTE_AT(index) (((index) < head_length) ? head[index] : tail[(index) - head_length])
+    while (zeros < length && BYTE_AT(zeros) == 0) { zeros++; }
+
+    for (size_t index = zeros; index < length;) {
+        size_t take = (index == zeros && (length - zeros) % 4) ? (length - zeros) % 4 : 4;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < take; i++) { carry = (carry << 8) | BYTE_AT(index + i); }
+        index += take;
+        for (size_t i = 0; i < used; i++) {
+            uint64_t t = ((uint64_t) limbs[i] << (8 * take)) + carry;
+            limbs[i] = (uint32_t) (t % LIMB_RADIX);
+            carry = t / LIMB_RADIX;
         }
-    } else {
-        fprintf(stderr, "Invalid switch, use -e or -d\n");
-        return EXIT_FAILURE;
+        for (; carry > 0; carry /= LIMB_RADIX) { limbs[used++] = (uint32_t) (carry % LIMB_RADIX); }
     }
-    return EXIT_SUCCESS;
+#undef BYTE_AT
+
+    char *end = out;
+    for (size_t i = 0; i < zeros; i++) { *end++ = alphabet[0]; }
+    if (used > 0) {
+        char top[5];
+        int digits = 0;
+        for (uint32_t limb = limbs[used - 1]; limb > 0; limb /= 58) { top[digits++] = alphabet[limb % 58]; }
+        while (digits > 0) { *end++ = top[--digits]; }
+        for (size_t i = used - 1; i-- > 0; end += 5) {
+            uint32_t limb = limbs[i];
+            for (int j = 4; j >= 0; j--, limb /= 58) { end[j] = alphabet[limb % 58]; }
+        }
+    }
+    return (size_t) (end - out);
+}
+
+size_t b58_bignum_encode(const b58_codec *codec, const void *in, size_t length, uint32_t *limbs, char *out) {
+    return bignum_encode(codec, in, length, NULL, 0, limbs, out);
+}
+
+bool b58_bignum_decode(const b58_codec *codec, const char *in, size_t length, uint32_t *limbs, unsigned char *out,
+                       size_t *written) {
+    static const uint32_t POWERS[6] = {1, 58, 58 * 58, 58 * 58 * 58, 58 * 58 * 58 * 58, LIMB_RADIX};
+    size_t zeros = 0, used = 0, index = 0;
+    bool leading = true;
+    uint32_t chunk = 0;
+    int digits = 0;
+    for (; index <= length; index++) {
+        if (index < length) {
+            unsigned char class = codec->table[(unsigned char) in[index]];
+            if (class & SPACE_FLAG) { continue; }
+            if (!class) {
+                *written = index;
+                return false;
+            }
+            unsigned char digit = class & DIGIT_MASK;
+            if (leading && digit == 0) {
+                zeros++;
+                continue;
+            }
+            leading = false;
+            chunk = chunk * 58 + digit;
+            if (++digits < 5) { continue; }
+        }
+        uint64_t carry = chunk;
+        for (size_t i = 0; i < used; i++) {
+            uint64_t t = (uint64_t) limbs[i] * POWERS[digits] + carry;
+            limbs[i] = (uint32_t) t;
+            carry = t >> 32;
+        }
+        for (; carry > 0; carry >>= 32) { limbs[used++] = (uint32_t) carry; }
+        chunk = 0;
+        digits = 0;
+    }
+
+    unsigned char *end = out;
+    memset(end, 0, zeros);
+    end += zeros;
+    bool significant = false;
+    for (size_t i = used; i-- > 0;) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            unsigned char byte = (unsigned char) (limbs[i] >> shift);
+            significant = significant || byte != 0;
+            if (significant) { *end++ = byte; }
+        }
+    }
+    *written = (size_t) (end - out);
+    return true;
+}
+
+static void check_checksum(const unsigned char *in, size_t length, unsigned char checksum[4]) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    sha256(in, length, digest);
+    sha256(digest, sizeof(digest), digest);
+    memcpy(checksum, digest, 4);
+}
+
+size_t b58_check_encode(const b58_codec *codec, const void *in, size_t length, uint32_t *limbs, char *out) {
+    unsigned char checksum[4];
+    check_checksum(in, length, checksum);
+    return bignum_encode(codec, in, length, checksum, 4, limbs, out);
+}
+
+enum b58_result b58_check_decode(const b58_codec *codec, const char *in, size_t length, uint32_t *limbs,
+                                 unsigned char *out, size_t *written) {
+    if (!b58_bignum_decode(codec, in, length, limbs, out, written)) { return b58_invalid; }
+    if (*written < 4) { return b58_checksum_error; }
+    unsigned char checksum[4];
+    *written -= 4;
+    check_checksum(out, *written, checksum);
+    return memcmp(checksum, out + *written, 4) == 0 ? b58_ok : b58_checksum_error;
 }
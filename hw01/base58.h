@@ -0,0 +1,292 @@
+/**
+ * @file base58.h
+ * @brief Base58 codec of fixed-width groups.
+ *
+ * By default every group of 4 bytes (a big-endian 32-bit number) is encoded
+ * as 6 digits of the Bitcoin alphabet
+ * @c 123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz.
+ * The Ripple and Flickr alphabets and groups of 1, 2 and 8 bytes (2, 3 and
+ * 11 digits) are available too, see b58_codec_find(). Every combination
+ * has its own kernels specialized at compile time.
+ * An incomplete last group is padded by zero bytes. The decoder skips
+ * whitespace and writes bytes of every group up to its first zero byte,
+ * which drops the padding again.
+ *
+ * The codec never allocates, all output goes to buffers provided by the
+ * caller, sized by the *_size() helpers. Encoders and decoders keep the
+ * incomplete group between calls, so the input may be fed in pieces of
+ * any size.
+ *
+ * Besides the group format, the whole-buffer format used by Bitcoin
+ * (the input is one big number, every leading zero byte is encoded as '1')
+ * and its Base58Check variant with a checksum are provided, see the
+ * b58_bignum_* and b58_check_* functions.
+ */
+
+#ifndef BASE58_H
+#define BASE58_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define B58_MAX_GROUP_BYTES 8
+#define B58_MAX_GROUP_DIGITS 11
+
+/* ************************************************************** *
+ *                             Codecs                             *
+ * ************************************************************** */
+
+/** alphabet and group width, all functions below take one */
+typedef struct b58_codec b58_codec;
+
+/**
+ * @brief Bitcoin alphabet, 4-byte groups.
+ */
+const b58_codec *b58_codec_default(void);
+
+/**
+ * @brief Look up a codec.
+ *
+ * @param alphabet "bitcoin", "ripple" or "flickr"
+ * @param group_bytes 1, 2, 4 or 8
+ * @return NULL if there is no such codec
+ */
+const b58_codec *b58_codec_find(const char *alphabet, size_t group_bytes);
+
+const char *b58_codec_alphabet(const b58_codec *codec);
+
+size_t b58_codec_group_bytes(const b58_codec *codec);
+
+size_t b58_codec_group_digits(const b58_codec *codec);
+
+/* ************************************************************** *
+ *                            Backends                            *
+ * ************************************************************** */
+
+/** kernels of 4-byte groups and of compaction, the widest one the CPU supports is selected at startup */
+enum b58_backend { b58_backend_scalar, b58_backend_sse41, b58_backend_avx2 };
+
+/**
+ * @brief Switch the kernels of all codecs, meant for benchmarks and tests.
+ *
+ * Not thread-safe, no codec may be in use meanwhile. The output does not
+ * depend on the backend.
+ *
+ * @return false if the CPU does not support the backend, nothing changes then
+ */
+bool b58_select_backend(enum b58_backend backend);
+
+enum b58_backend b58_selected_backend(void);
+
+const char *b58_backend_name(enum b58_backend backend);
+
+/* ************************************************************** *
+ *                        Incremental API                         *
+ * ************************************************************** */
+
+typedef struct b58_encoder
+{
+    const b58_codec *codec;
+    unsigned char carry[B58_MAX_GROUP_BYTES];
+    size_t carried;
+} b58_encoder;
+
+typedef struct b58_decoder
+{
+    const b58_codec *codec;
+    unsigned char carry[B58_MAX_GROUP_DIGITS];
+    size_t carried;
+
+    /** number of input bytes consumed so far */
+    size_t offset;
+    /** offset of the offending input byte, set when decoding fails */
+    size_t error_offset;
+} b58_decoder;
+
+/**
+ * @brief Prepare the encoder for a new input.
+ */
+void b58_encode_init(b58_encoder *encoder, const b58_codec *codec);
+
+/**
+ * @brief Exact number of characters written by b58_encode_update()
+ * for the next length bytes.
+ */
+size_t b58_encode_update_size(const b58_encoder *encoder, size_t length);
+
+/**
+ * @brief Encode all complete groups, keep the rest for the next call.
+ *
+ * @param out buffer of at least b58_encode_update_size() characters
+ * @return number of characters written, the output is not terminated
+ */
+size_t b58_encode_update(b58_encoder *encoder, const void *in, size_t length, char *out);
+
+/**
+ * @brief Exact number of characters written by b58_encode_final(),
+ * either 0 or the digits of one group.
+ */
+size_t b58_encode_final_size(const b58_encoder *encoder);
+
+/**
+ * @brief Encode the incomplete group padded by zero bytes, if there is any.
+ *
+ * The encoder may be used for a new input afterwards.
+ *
+ * @return number of characters written
+ */
+size_t b58_encode_final(b58_encoder *encoder, char *out);
+
+/**
+ * @brief Number of characters of the whole input of length bytes.
+ */
+size_t b58_encoded_size(const b58_codec *codec, size_t length);
+
+/**
+ * @brief Prepare the decoder for a new input.
+ */
+void b58_decode_init(b58_decoder *decoder, const b58_codec *codec);
+
+/**
+ * @brief Upper bound of bytes written by b58_decode_update() for the next
+ * length characters.
+ *
+ * The bound is exact unless the decoded groups contain zero bytes.
+ */
+size_t b58_decode_update_size(const b58_decoder *decoder, size_t length);
+
+/**
+ * @brief Decode all complete groups, keep the rest for the next call.
+ *
+ * @param out buffer of at least b58_decode_update_size() bytes
+ * @param written number of bytes written, on failure bytes of all groups
+ * preceding the error
+ * @return false for invalid input, error_offset of the decoder is then set
+ * and the decoder must be initialized again before further use
+ */
+bool b58_decode_update(b58_decoder *decoder, const char *in, size_t length, unsigned char *out, size_t *written);
+
+/**
+ * @brief Check that the input does not end with an incomplete group.
+ *
+ * @return false for truncated input, error_offset is then the input length
+ */
+bool b58_decode_final(b58_decoder *decoder);
+
+/**
+ * @brief Upper bound of bytes of the whole input of length characters.
+ */
+size_t b58_decoded_size(const b58_codec *codec, size_t length);
+
+/* ************************************************************** *
+ *                           Block API                            *
+ * ************************************************************** */
+
+/**
+ * @brief Encode complete groups only.
+ *
+ * @param out buffer of groups * b58_codec_group_digits() characters
+ * @return number of characters written
+ */
+size_t b58_encode_groups(const b58_codec *codec, const unsigned char *in, size_t groups, char *out);
+
+/**
+ * @brief Store digit values of the input, skipping whitespace.
+ *
+ * @param digits buffer of length bytes
+ * @param count number of digits stored
+ * @return index of the first invalid byte, or length if there is none
+ */
+size_t b58_compact(const b58_codec *codec, const char *in, size_t length, unsigned char *digits, size_t *count);
+
+/**
+ * @brief Decode complete groups of digit values (see b58_compact()).
+ *
+ * @param out buffer of groups * b58_codec_group_bytes() bytes
+ * @param written number of bytes written
+ * @return number of groups decoded, less than groups if a group
+ * does not fit into its bytes
+ */
+size_t b58_decode_groups(const b58_codec *codec, const unsigned char *digits, size_t groups, unsigned char *out,
+                         size_t *written);
+
+/**
+ * @brief Index of the byte holding the digit with index digit, the input
+ * must contain such a digit.
+ */
+size_t b58_digit_offset(const b58_codec *codec, const char *in, size_t digit);
+
+/* ************************************************************** *
+ *                       Whole-buffer codec                       *
+ * ************************************************************** */
+
+/*
+ * Only the alphabet of the codec matters here, the group width does not.
+ */
+
+/**
+ * @brief Number of limbs of the scratch space needed by the whole-buffer
+ * functions for length bytes or characters of input.
+ */
+size_t b58_bignum_limbs(size_t length);
+
+/**
+ * @brief Upper bound of characters of the whole-buffer encoding of length
+ * bytes, add 4 bytes of checksum for b58_check_encode().
+ */
+size_t b58_bignum_encoded_size(size_t length);
+
+/**
+ * @brief Upper bound of bytes decoded from length characters.
+ */
+size_t b58_bignum_decoded_size(size_t length);
+
+/**
+ * @brief Encode the whole input as one big-endian number.
+ *
+ * @param limbs scratch space of b58_bignum_limbs(length) limbs
+ * @param out buffer of b58_bignum_encoded_size(length) characters
+ * @return number of characters written
+ */
+size_t b58_bignum_encode(const b58_codec *codec, const void *in, size_t length, uint32_t *limbs, char *out);
+
+/**
+ * @brief Decode the whole-buffer encoding, whitespace is skipped.
+ *
+ * @param limbs scratch space of b58_bignum_limbs(length) limbs
+ * @param out buffer of b58_bignum_decoded_size(length) bytes
+ * @param written number of bytes written, or offset of the invalid
+ * character on failure
+ * @return false if the input contains a character out of the alphabet
+ */
+bool b58_bignum_decode(const b58_codec *codec, const char *in, size_t length, uint32_t *limbs, unsigned char *out,
+                       size_t *written);
+
+/**
+ * @brief Encode the input followed by the first 4 bytes of its double
+ * SHA-256 (Base58Check). Version bytes are part of the input.
+ *
+ * @param limbs scratch space of b58_bignum_limbs(length + 4) limbs
+ * @param out buffer of b58_bignum_encoded_size(length + 4) characters
+ * @return number of characters written
+ */
+size_t b58_check_encode(const b58_codec *codec, const void *in, size_t length, uint32_t *limbs, char *out);
+
+/** outcome of a transformation, read and write errors are left to the caller */
+enum b58_result { b58_ok, b58_invalid, b58_checksum_error, b58_read_error, b58_write_error };
+
+/**
+ * @brief Decode Base58Check and verify the checksum.
+ *
+ * @param out buffer of b58_bignum_decoded_size(length) bytes, it receives
+ * the checksum too
+ * @param written number of payload bytes without the checksum, or offset
+ * of the invalid character
+ * @return b58_invalid for a character out of the alphabet,
+ * b58_checksum_error for a mismatch or less than 4 bytes
+ */
+enum b58_result b58_check_decode(const b58_codec *codec, const char *in, size_t length, uint32_t *limbs,
+                                 unsigned char *out, size_t *written);
+
+#endif //BASE58_H
@@ -0,0 +1,464 @@
+/*
+ * Throughput benchmark of the codec library.
+ *
+ * Every operation is measured on random payloads of 4 bytes up to
+ * --max-size, with every backend the CPU supports and with --threads
+ * threads. Decoding runs on dense text, on text wrapped at 76 columns and
+ * on text with a space after every group. Results are written as JSON,
+ * one result per line, and may be compared against a baseline of an
+ * earlier run (--baseline), regressions make the exit status non-zero.
+ *
+ * The largest payload needs about 4.5 times its size of memory.
+ */
+
+#include "base58.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MIN_SIZE 4
+#define SIZE_STEP 16
+#define LINE_WIDTH 76
+/* threads are started per call, that pays off for large payloads only */
+#define MIN_THREADED_SIZE (1024 * 1024)
+#define MAX_THREADS 256
+#define MAX_RESULTS 256
+
+struct options {
+    size_t max_size;
+    double min_time;
+    size_t threads;
+    const b58_codec *codec;
+    const char *output;
+    const char *baseline;
+    double tolerance;
+};
+
+struct result {
+    char operation[16];
+    char backend[16];
+    char input[16];
+    size_t size;
+    size_t bytes;
+    size_t iterations;
+    double seconds;
+    double mb_per_s;
+};
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* ************************************************************** *
+ *                           Operations                           *
+ * ************************************************************** */
+
+/*
+ * One call of the benchmarked operation, in and out stay allocated for
+ * the whole measurement.
+ */
+struct job {
+    const b58_codec *codec;
+    const void *in;
+    size_t length;
+    void *out;
+
+    /* threaded only, slice boundaries of in and out */
+    size_t slices;
+    size_t in_bounds[MAX_THREADS + 1];
+    size_t out_bounds[MAX_THREADS + 1];
+};
+
+static void encode_slice(const b58_codec *codec, const void *in, size_t length, char *out) {
+    b58_encoder encoder;
+    b58_encode_init(&encoder, codec);
+    size_t written = b58_encode_update(&encoder, in, length, out);
+    b58_encode_final(&encoder, out + written);
+}
+
+static void decode_slice(const b58_codec *codec, const char *in, size_t length, unsigned char *out) {
+    b58_decoder decoder;
+    size_t written;
+    b58_decode_init(&decoder, codec);
+    if (!b58_decode_update(&decoder, in, length, out, &written) || !b58_decode_final(&decoder)) {
+        fprintf(stderr, "Benchmark input doesn't decode!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void run_encode(struct job *job) {
+    encode_slice(job->codec, job->in, job->length, job->out);
+}
+
+static void run_decode(struct job *job) {
+    decode_slice(job->codec, job->in, job->length, job->out);
+}
+
+struct slice {
+    struct job *job;
+    size_t index;
+    bool decoding;
+};
+
+static void *slice_thread(void *argument) {
+    struct slice *slice = argument;
+    struct job *job = slice->job;
+    size_t begin = job->in_bounds[slice->index], end = job->in_bounds[slice->index + 1];
+    if (slice->decoding) {
+        decode_slice(job->codec, (const char *) job->in + begin, end - begin,
+                     (unsigned char *) job->out + job->out_bounds[slice->index]);
+    } else {
+        encode_slice(job->codec, (const unsigned char *) job->in + begin, end - begin,
+                     (char *) job->out + job->out_bounds[slice->index]);
+    }
+    return NULL;
+}
+
+static void run_threaded(struct job *job, bool decoding) {
+    pthread_t threads[MAX_THREADS];
+    struct slice slices[MAX_THREADS];
+    for (size_t i = 0; i < job->slices; i++) {
+        slices[i] = (struct slice) {job, i, decoding};
+        if (pthread_create(&threads[i], NULL, slice_thread, &slices[i]) != 0) {
+            fprintf(stderr, "Failed to start a thread!\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (size_t i = 0; i < job->slices; i++) { pthread_join(threads[i], NULL); }
+}
+
+static void run_threaded_encode(struct job *job) {
+    run_threaded(job, false);
+}
+
+static void run_threaded_decode(struct job *job) {
+    run_threaded(job, true);
+}
+
+/*
+ * Encoding slices hold whole groups. Decoding slices are split where the
+ * digits before them form whole groups, every slice decodes into its own
+ * part of out (zero bytes dropped by the decoder leave gaps there).
+ */
+static void split_payload(struct job *job, size_t slices) {
+    size_t bytes = b58_codec_group_bytes(job->codec), digits = b58_codec_group_digits(job->codec);
+    size_t groups = (job->length + bytes - 1) / bytes;
+    job->slices = slices;
+    for (size_t i = 0; i <= slices; i++) {
+        size_t group = groups * i / slices;
+        job->in_bounds[i] = (group * bytes < job->length) ? group * bytes : job->length;
+        job->out_bounds[i] = group * digits;
+    }
+}
+
+static void split_text(struct job *job, size_t slices) {
+    size_t bytes = b58_codec_group_bytes(job->codec), digits = b58_codec_group_digits(job->codec);
+    const char *text = job->in;
+    size_t count = 0, slice = 1;
+    for (size_t i = 0; i < job->length; i++) {
+        if (text[i] != ' ' && text[i] != '\n') { count++; }
+    }
+    size_t groups = count / digits;
+    job->slices = slices;
+    job->in_bounds[0] = job->out_bounds[0] = 0;
+    count = 0;
+    for (size_t i = 0; i < job->length && slice < slices; i++) {
+        if (text[i] == ' ' || text[i] == '\n') { continue; }
+        if (count == groups * slice / slices * digits) {
+            job->in_bounds[slice] = i;
+            job->out_bounds[slice] = count / digits * bytes;
+            slice++;
+        }
+        count++;
+    }
+    for (; slice <= slices; slice++) {
+        job->in_bounds[slice] = job->length;
+        job->out_bounds[slice] = groups * bytes;
+    }
+}
+
+/* ************************************************************** *
+ *                          Measurement                           *
+ * ************************************************************** */
+
+struct report {
+    struct result results[MAX_RESULTS];
+    size_t count;
+};
+
+/*
+ * The number of calls doubles until one batch takes min_time, only the
+ * last batch counts, so the per-call latency of tiny payloads is not
+ * buried under the clock overhead.
+ */
+static void measure(struct report *report, const struct options *options, const char *operation,
+                    const char *backend, const char *input, size_t size, void (*run)(struct job *),
+                    struct job *job) {
+    size_t iterations = 1;
+    double seconds;
+    run(job);
+    for (;;) {
+        double start = now();
+        for (size_t i = 0; i < iterations; i++) { run(job); }
+        seconds = now() - start;
+        if (seconds >= options->min_time) { break; }
+        iterations *= 2;
+    }
+    if (report->count == MAX_RESULTS) { return; }
+    struct result *result = &report->results[report->count++];
+    snprintf(result->operation, sizeof(result->operation), "%s", operation);
+    snprintf(result->backend, sizeof(result->backend), "%s", backend);
+    snprintf(result->input, sizeof(result->input), "%s", input);
+    result->size = size;
+    result->bytes = job->length;
+    result->iterations = iterations;
+    result->seconds = seconds;
+    result->mb_per_s = (double) job->length * (double) iterations / seconds / 1e6;
+}
+
+/*
+ * Decoder input: dense, wrapped at LINE_WIDTH columns, or every group
+ * followed by a space and a newline after every 12 groups.
+ */
+static char *make_text(const char *encoded, size_t length, const char *layout, size_t digits, size_t *text_length) {
+    size_t capacity = !strcmp(layout, "spaced") ? length + length / digits + 1 : length + length / LINE_WIDTH + 1;
+    char *text = malloc(capacity);
+    if (!text) { return NULL; }
+    size_t used = 0;
+    for (size_t i = 0; i < length; i++) {
+        text[used++] = encoded[i];
+        if (!strcmp(layout, "wrapped") && (i + 1) % LINE_WIDTH == 0) {
+            text[used++] = '\n';
+        } else if (!strcmp(layout, "spaced") && (i + 1) % digits == 0) {
+            text[used++] = ((i + 1) % (12 * digits) == 0) ? '\n' : ' ';
+        }
+    }
+    *text_length = used;
+    return text;
+}
+
+/* other widths than 4 bytes have scalar kernels only */
+static size_t available_backends(const b58_codec *codec, enum b58_backend backends[3]) {
+    enum b58_backend initial = b58_selected_backend();
+    int last = (b58_codec_group_bytes(codec) == 4) ? b58_backend_avx2 : b58_backend_scalar;
+    size_t count = 0;
+    for (int backend = b58_backend_scalar; backend <= last; backend++) {
+        if (b58_select_backend((enum b58_backend) backend)) { backends[count++] = (enum b58_backend) backend; }
+    }
+    b58_select_backend(initial);
+    return count;
+}
+
+static bool benchmark_size(struct report *report, const struct options *options, size_t size, uint64_t *random) {
+    static const char *const LAYOUTS[] = {"dense", "wrapped", "spaced"};
+    const b58_codec *codec = options->codec;
+    size_t encoded_length = b58_encoded_size(codec, size);
+    unsigned char *payload = malloc(size);
+    char *encoded = malloc(encoded_length);
+    if (!payload || !encoded) {
+        free(payload);
+        free(encoded);
+        return false;
+    }
+    for (size_t i = 0; i < size; i++) { payload[i] = (unsigned char) next_random(random); }
+
+    enum b58_backend backends[3], initial = b58_selected_backend();
+    size_t count = available_backends(codec, backends);
+    bool threaded = options->threads > 1 && size >= MIN_THREADED_SIZE;
+
+    struct job job = {.codec = codec, .in = payload, .length = size, .out = encoded};
+    for (size_t i = 0; i < count; i++) {
+        b58_select_backend(backends[i]);
+        measure(report, options, "encode", b58_backend_name(backends[i]), "random", size, run_encode, &job);
+    }
+    b58_select_backend(initial);
+    if (threaded) {
+        split_payload(&job, options->threads);
+        measure(report, options, "encode", "threaded", "random", size, run_threaded_encode, &job);
+    }
+
+    /* the payload is not needed anymore, the decoder output goes there */
+    for (size_t layout = 0; layout < sizeof(LAYOUTS) / sizeof(LAYOUTS[0]); layout++) {
+        size_t text_length = encoded_length;
+        char *text = (layout == 0) ? encoded
+                                   : make_text(encoded, encoded_length, LAYOUTS[layout], b58_codec_group_digits(codec),
+                                               &text_length);
+        if (!text) { break; }
+        job = (struct job) {.codec = codec, .in = text, .length = text_length, .out = payload};
+        for (size_t i = 0; i < count; i++) {
+            b58_select_backend(backends[i]);
+            measure(report, options, "decode", b58_backend_name(backends[i]), LAYOUTS[layout], size, run_decode,
+                    &job);
+        }
+        b58_select_backend(initial);
+        if (threaded) {
+            split_text(&job, options->threads);
+            measure(report, options, "decode", "threaded", LAYOUTS[layout], size, run_threaded_decode, &job);
+        }
+        if (text != encoded) { free(text); }
+    }
+    free(payload);
+    free(encoded);
+    return true;
+}
+
+/* ************************************************************** *
+ *                             Output                             *
+ * ************************************************************** */
+
+static void print_result(FILE *file, const struct result *result, bool last) {
+    fprintf(file, "    {\"operation\": \"%s\", \"backend\": \"%s\", \"input\": \"%s\", \"size\": %zu, "
+                  "\"bytes\": %zu, \"iterations\": %zu, \"seconds\": %.6f, \"mb_per_s\": %.2f, "
+                  "\"ns_per_call\": %.1f}%s\n",
+            result->operation, result->backend, result->input, result->size, result->bytes, result->iterations,
+            result->seconds, result->mb_per_s, result->seconds * 1e9 / (double) result->iterations, last ? "" : ",");
+}
+
+static bool print_report(const struct report *report, const struct options *options) {
+    FILE *file = options->output ? fopen(options->output, "w") : stdout;
+    if (!file) { return false; }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"alphabet\": \"%s\",\n", b58_codec_alphabet(options->codec));
+    fprintf(file, "  \"group_bytes\": %zu,\n", b58_codec_group_bytes(options->codec));
+    fprintf(file, "  \"default_backend\": \"%s\",\n", b58_backend_name(b58_selected_backend()));
+    fprintf(file, "  \"threads\": %zu,\n", options->threads);
+    fprintf(file, "  \"min_time\": %.3f,\n", options->min_time);
+    fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < report->count; i++) { print_result(file, &report->results[i], i + 1 == report->count); }
+    fprintf(file, "  ]\n}\n");
+    bool written = !ferror(file);
+    if (file != stdout) { written = fclose(file) == 0 && written; }
+    return written;
+}
+
+/*
+ * The baseline is the output of an earlier run, one result per line.
+ * Returns the number of results slower than the baseline by more than
+ * the tolerance, or -1 if the baseline can't be read.
+ */
+static int compare_baseline(const struct report *report, const struct options *options) {
+    FILE *file = fopen(options->baseline, "r");
+    if (!file) { return -1; }
+    char line[512];
+    int regressions = 0;
+    while (fgets(line, sizeof(line), file)) {
+        struct result old;
+        if (sscanf(line, " {\"operation\": \"%15[^\"]\", \"backend\": \"%15[^\"]\", \"input\": \"%15[^\"]\", "
+                         "\"size\": %zu, \"bytes\": %zu, \"iterations\": %zu, \"seconds\": %lf, \"mb_per_s\": %lf",
+                   old.operation, old.backend, old.input, &old.size, &old.bytes, &old.iterations, &old.seconds,
+                   &old.mb_per_s) != 8) {
+            continue;
+        }
+        for (size_t i = 0; i < report->count; i++) {
+            const struct result *new = &report->results[i];
+            if (strcmp(new->operation, old.operation) || strcmp(new->backend, old.backend)
+                || strcmp(new->input, old.input) || new->size != old.size) {
+                continue;
+            }
+            double change = (new->mb_per_s / old.mb_per_s - 1) * 100;
+            if (change < -options->tolerance) {
+                fprintf(stderr, "Regression: %s %s %s %zu: %.2f -> %.2f MB/s (%.1f%%)\n", new->operation,
+                        new->backend, new->input, new->size, old.mb_per_s, new->mb_per_s, change);
+                regressions++;
+            }
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: base58_bench [--max-size BYTES] [--min-time SECONDS] [--threads N]\n"
+                    "                    [-a ALPHABET] [-w BYTES] [-o FILE] [--baseline FILE [--tolerance PERCENT]]\n");
+}
+
+static bool parse_size(const char *text, size_t minimum, size_t *value) {
+    char *end = NULL;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (*end != '\0' || end == text || parsed < minimum || parsed > SIZE_MAX) { return false; }
+    *value = (size_t) parsed;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    struct options options = {
+            .max_size = (size_t) 1 << 30,
+            .min_time = 0.2,
+            .threads = (processors > 0) ? (size_t) processors : 1,
+            .tolerance = 10,
+    };
+    const char *alphabet = "bitcoin";
+    size_t group_bytes = 4;
+    for (int i = 1; i < argc; i++) {
+        bool valid = i + 1 < argc;
+        if (valid && !strcmp(argv[i], "--max-size")) {
+            valid = parse_size(argv[++i], MIN_SIZE, &options.max_size);
+        } else if (valid && !strcmp(argv[i], "--min-time")) {
+            options.min_time = strtod(argv[++i], NULL);
+            valid = options.min_time > 0;
+        } else if (valid && !strcmp(argv[i], "--threads")) {
+            valid = parse_size(argv[++i], 1, &options.threads) && options.threads <= MAX_THREADS;
+        } else if (valid && !strcmp(argv[i], "-a")) {
+            alphabet = argv[++i];
+        } else if (valid && !strcmp(argv[i], "-w")) {
+            valid = parse_size(argv[++i], 1, &group_bytes);
+        } else if (valid && !strcmp(argv[i], "-o")) {
+            options.output = argv[++i];
+        } else if (valid && !strcmp(argv[i], "--baseline")) {
+            options.baseline = argv[++i];
+        } else if (valid && !strcmp(argv[i], "--tolerance")) {
+            options.tolerance = strtod(argv[++i], NULL);
+            valid = options.tolerance >= 0;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    options.codec = b58_codec_find(alphabet, group_bytes);
+    if (!options.codec) {
+        fprintf(stderr, "Unsupported codec, use -a bitcoin, ripple or flickr and -w 1, 2, 4 or 8\n");
+        return EXIT_FAILURE;
+    }
+
+    static struct report report;
+    uint64_t random = 0x9e3779b97f4a7c15u;
+    for (size_t size = MIN_SIZE; size <= options.max_size; size *= SIZE_STEP) {
+        if (!benchmark_size(&report, &options, size, &random)) {
+            fprintf(stderr, "Not enough memory for %zu bytes, larger payloads skipped\n", size);
+            break;
+        }
+        if (size > options.max_size / SIZE_STEP) { break; }
+    }
+    if (!print_report(&report, &options)) {
+        fprintf(stderr, "Failed to write results!\n");
+        return EXIT_FAILURE;
+    }
+    if (options.baseline) {
+        int regressions = compare_baseline(&report, &options);
+        if (regressions < 0) {
+            fprintf(stderr, "Failed to read baseline %s\n", options.baseline);
+            return EXIT_FAILURE;
+        }
+        if (regressions > 0) { return EXIT_FAILURE; }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,837 @@
+#ifdef __linux__
+#define _GNU_SOURCE // F_GETPIPE_SZ
+#endif
+
+#include "base58.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Input is processed in chunks of INPUT_CHUNK bytes, a multiple of every
+ * group width. Groups of 1 byte take 2 digits, the most of all codecs.
+ */
+#define INPUT_CHUNK (65536 * 4)
+#define OUTPUT_CHUNK (INPUT_CHUNK * 2 + 1)
+
+static size_t read_full(int fd, unsigned char *buffer, size_t length) {
+    size_t total = 0;
+    while (total < length) {
+        ssize_t count = read(fd, buffer + total, length - total);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+        total += (size_t) count;
+    }
+    return total;
+}
+
+static bool write_all(int fd, const void *data, size_t length) {
+    const char *bytes = data;
+    while (length > 0) {
+        ssize_t count = write(fd, bytes, length);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count < 0) { return false; }
+        bytes += count;
+        length -= (size_t) count;
+    }
+    return true;
+}
+
+/* ************************************************************** *
+ *                        Input and output                        *
+ * ************************************************************** */
+
+/*
+ * A regular file is mapped and transformed in place, any other input
+ * is read into the buffer chunk by chunk.
+ */
+struct source {
+    int fd;
+    const unsigned char *mapped;
+    unsigned char *buffer;
+    size_t length;
+    bool finished;
+};
+
+static bool source_open(struct source *source, int fd) {
+    struct stat info;
+    source->fd = fd;
+    source->mapped = NULL;
+    source->buffer = NULL;
+    source->length = 0;
+    source->finished = false;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0
+        && (uintmax_t) info.st_size <= SIZE_MAX) {
+        void *mapped = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            posix_madvise(mapped, (size_t) info.st_size, POSIX_MADV_SEQUENTIAL);
+            source->mapped = mapped;
+            source->length = (size_t) info.st_size;
+            return true;
+        }
+    }
+    source->buffer = malloc(INPUT_CHUNK);
+    return source->buffer != NULL;
+}
+
+/*
+ * Returns the next block of input, length 0 marks its end.
+ */
+static const unsigned char *source_next(struct source *source, size_t *length) {
+    if (source->finished) {
+        *length = 0;
+        return source->buffer;
+    }
+    if (source->mapped) {
+        source->finished = true;
+        *length = source->length;
+        return source->mapped;
+    }
+    *length = read_full(source->fd, source->buffer, INPUT_CHUNK);
+    source->finished = *length < INPUT_CHUNK;
+    return source->buffer;
+}
+
+static void source_close(struct source *source) {
+    if (source->mapped) { munmap((void *) source->mapped, source->length); }
+    free(source->buffer);
+}
+
+/*
+ * Output is produced directly into the page-aligned sink buffer and
+ * written once the buffer is full. When stdout is a pipe, the buffer is
+ * as large as the pipe, so every write fills it at once.
+ */
+struct sink {
+    int fd;
+    char *buffer;
+    size_t size;
+    size_t used;
+};
+
+static bool sink_open(struct sink *sink, int fd) {
+    sink->fd = fd;
+    sink->used = 0;
+    sink->size = OUTPUT_CHUNK;
+#if defined(__linux__)
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode)) {
+        int capacity = fcntl(fd, F_GETPIPE_SZ);
+        if (capacity > 0) { sink->size = (size_t) capacity; }
+    }
+#endif
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, (size_t) sysconf(_SC_PAGESIZE), sink->size) != 0) { return false; }
+    sink->buffer = buffer;
+    return true;
+}
+
+static bool sink_flush(struct sink *sink) {
+    bool written = write_all(sink->fd, sink->buffer, sink->used);
+    sink->used = 0;
+    return written;
+}
+
+/*
+ * Free space in the current buffer, never empty.
+ */
+static char *sink_space(struct sink *sink, size_t *space) {
+    if (sink->used == sink->size && !sink_flush(sink)) { return NULL; }
+    *space = sink->size - sink->used;
+    return sink->buffer + sink->used;
+}
+
+static bool sink_put(struct sink *sink, const void *data, size_t length) {
+    const char *bytes = data;
+    while (length > 0) {
+        size_t space;
+        char *out = sink_space(sink, &space);
+        if (!out) { return false; }
+        size_t count = (length < space) ? length : space;
+        memcpy(out, bytes, count);
+        sink->used += count;
+        bytes += count;
+        length -= count;
+    }
+    return true;
+}
+
+static void sink_close(struct sink *sink) {
+    free(sink->buffer);
+}
+
+/* ************************************************************** *
+ *                        Single-threaded                         *
+ * ************************************************************** */
+
+/*
+ * Encodes one chunk, only the last chunk may end with an incomplete group
+ * and gets the trailing newline.
+ */
+static size_t encode_chunk(const b58_codec *codec, const unsigned char *in, size_t length, bool last, char *out) {
+    b58_encoder encoder;
+    b58_encode_init(&encoder, codec);
+    size_t written = b58_encode_update(&encoder, in, length, out);
+    if (last) {
+        written += b58_encode_final(&encoder, out + written);
+        out[written++] = '\n';
+    }
+    return written;
+}
+
+/*
+ * Encodes as many groups as fit into the sink at once, a group which
+ * would straddle the end of the sink buffer goes through a small copy.
+ */
+static bool encode_into(struct sink *sink, b58_encoder *encoder, const unsigned char *in, size_t length) {
+    size_t bytes = b58_codec_group_bytes(encoder->codec), digits = b58_codec_group_digits(encoder->codec);
+    while (length > 0) {
+        size_t space, take;
+        char *out = sink_space(sink, &space);
+        if (!out) { return false; }
+        if (space < digits) {
+            char group[B58_MAX_GROUP_DIGITS];
+            take = (length < bytes - encoder->carried) ? length : bytes - encoder->carried;
+            if (!sink_put(sink, group, b58_encode_update(encoder, in, take, group))) { return false; }
+        } else {
+            take = space / digits * bytes - encoder->carried;
+            take = (length < take) ? length : take;
+            sink->used += b58_encode_update(encoder, in, take, out);
+        }
+        in += take;
+        length -= take;
+    }
+    return true;
+}
+
+enum b58_result encode(const b58_codec *codec, int input, int output) {
+    struct source source;
+    struct sink sink;
+    b58_encoder encoder;
+    if (!sink_open(&sink, output)) { return b58_write_error; }
+    if (!source_open(&source, input)) {
+        source_close(&source);
+        sink_close(&sink);
+        return b58_read_error;
+    }
+    b58_encode_init(&encoder, codec);
+
+    bool written = true;
+    const unsigned char *in;
+    size_t length;
+    while (written && (in = source_next(&source, &length), length > 0)) {
+        written = encode_into(&sink, &encoder, in, length);
+    }
+    char last[B58_MAX_GROUP_DIGITS + 1];
+    size_t count = b58_encode_final(&encoder, last);
+    last[count++] = '\n';
+    written = written && sink_put(&sink, last, count) && sink_flush(&sink);
+
+    source_close(&source);
+    sink_close(&sink);
+    return written ? b58_ok : b58_write_error;
+}
+
+/*
+ * Decodes as much input as surely fits into the sink at once, a group
+ * which might straddle the end of the sink buffer goes through a small copy.
+ */
+static bool decode_into(struct sink *sink, b58_decoder *decoder, const char *in, size_t length, bool *valid) {
+    size_t bytes = b58_codec_group_bytes(decoder->codec), digits = b58_codec_group_digits(decoder->codec);
+    while (length > 0 && *valid) {
+        size_t space, take, written;
+        char *out = sink_space(sink, &space);
+        if (!out) { return false; }
+        if (space < bytes) {
+            unsigned char group[B58_MAX_GROUP_BYTES];
+            take = (length < digits - decoder->carried) ? length : digits - decoder->carried;
+            *valid = b58_decode_update(decoder, in, take, group, &written);
+            if (!sink_put(sink, group, written)) { return false; }
+        } else {
+            take = space / bytes * digits - decoder->carried;
+            take = (length < take) ? length : take;
+            *valid = b58_decode_update(decoder, in, take, (unsigned char *) out, &written);
+            sink->used += written;
+        }
+        in += take;
+        length -= take;
+    }
+    return true;
+}
+
+/*
+ * On invalid input, error_offset is set to the offending byte (the last
+ * digit of a group which overflows, or the end of a truncated input).
+ */
+enum b58_result decode(const b58_codec *codec, int input, int output, size_t *error_offset) {
+    struct source source;
+    struct sink sink;
+    b58_decoder decoder;
+    if (!sink_open(&sink, output)) { return b58_write_error; }
+    if (!source_open(&source, input)) {
+        source_close(&source);
+        sink_close(&sink);
+        return b58_read_error;
+    }
+    b58_decode_init(&decoder, codec);
+
+    bool written = true, valid = true;
+    const unsigned char *in;
+    size_t length;
+    while (written && valid && (in = source_next(&source, &length), length > 0)) {
+        written = decode_into(&sink, &decoder, (const char *) in, length, &valid);
+    }
+    valid = valid && b58_decode_final(&decoder);
+    written = written && sink_flush(&sink);
+    *error_offset = decoder.error_offset;
+
+    source_close(&source);
+    sink_close(&sink);
+    if (!written) { return b58_write_error; }
+    return valid ? b58_ok : b58_invalid;
+}
+
+/* ************************************************************** *
+ *                    Multi-threaded pipeline                     *
+ * ************************************************************** */
+
+/*
+ * The reader thread fills chunks in order, workers take them in the same
+ * order and transform them independently, the writer (main thread) emits
+ * the results in order and recycles the chunk slots.
+ *
+ * Decoding splits the input at arbitrary bytes, so a worker needs the
+ * number of digits in all the preceding chunks to know where its groups
+ * start. Workers publish their digit counts in order (which is cheap, it
+ * is known right after compaction), the first head digits complete the
+ * group left open by the preceding chunk and are merged by the writer.
+ */
+enum chunk_state { chunk_free, chunk_read, chunk_working, chunk_done };
+
+struct chunk {
+    enum chunk_state state;
+    size_t sequence;
+    size_t offset;
+    size_t length;
+    bool last;
+    unsigned char *input;
+    unsigned char *digits;
+    char *output;
+    size_t written;
+
+    /* decoding only */
+    size_t count;
+    size_t invalid;
+    size_t head;
+    size_t groups;
+    size_t overflow;
+};
+
+struct pipeline {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    const b58_codec *codec;
+    bool decoding;
+    bool abort;
+    /* written to on abort, wakes the reader blocked on its input */
+    int wake[2];
+
+    struct chunk *chunks;
+    size_t slots;
+
+    size_t next_work;
+    bool all_taken;
+
+    size_t aligned;
+    size_t digits_total;
+};
+
+static void wait_changed(struct pipeline *pipeline) {
+    pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+}
+
+static void set_state(struct pipeline *pipeline, struct chunk *chunk, enum chunk_state state) {
+    pthread_mutex_lock(&pipeline->lock);
+    chunk->state = state;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+/*
+ * Fills the chunk like read_full(), but gives up as soon as the pipeline
+ * is woken for abort.
+ */
+static size_t read_chunk(struct pipeline *pipeline, unsigned char *buffer) {
+    struct pollfd fds[2] = {{.fd = STDIN_FILENO, .events = POLLIN}, {.fd = pipeline->wake[0], .events = POLLIN}};
+    size_t total = 0;
+    while (total < INPUT_CHUNK) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        if (fds[1].revents != 0) { break; }
+        ssize_t count = read(STDIN_FILENO, buffer + total, INPUT_CHUNK - total);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+        total += (size_t) count;
+    }
+    return total;
+}
+
+static void *reader_thread(void *argument) {
+    struct pipeline *pipeline = argument;
+    size_t offset = 0;
+    for (size_t sequence = 0;; sequence++) {
+        struct chunk *chunk = &pipeline->chunks[sequence % pipeline->slots];
+        pthread_mutex_lock(&pipeline->lock);
+        while (chunk->state != chunk_free && !pipeline->abort) { wait_changed(pipeline); }
+        bool abort = pipeline->abort;
+        pthread_mutex_unlock(&pipeline->lock);
+        if (abort) { break; }
+
+        chunk->length = read_chunk(pipeline, chunk->input);
+        pthread_mutex_lock(&pipeline->lock);
+        abort = pipeline->abort;
+        pthread_mutex_unlock(&pipeline->lock);
+        if (abort) { break; }
+
+        chunk->sequence = sequence;
+        chunk->offset = offset;
+        chunk->last = chunk->length < INPUT_CHUNK;
+        offset += chunk->length;
+        set_state(pipeline, chunk, chunk_read);
+        if (chunk->last) { break; }
+    }
+    return NULL;
+}
+
+static void decode_chunk(struct pipeline *pipeline, struct chunk *chunk) {
+    const b58_codec *codec = pipeline->codec;
+    size_t digits = b58_codec_group_digits(codec);
+    chunk->invalid = b58_compact(codec, (const char *) chunk->input, chunk->length, chunk->digits, &chunk->count);
+
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->aligned != chunk->sequence && !pipeline->abort) { wait_changed(pipeline); }
+    size_t preceding = pipeline->digits_total;
+    pipeline->digits_total += chunk->count;
+    pipeline->aligned++;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    size_t open = (digits - preceding % digits) % digits;
+    chunk->head = (open < chunk->count) ? open : chunk->count;
+    chunk->groups = (chunk->count - chunk->head) / digits;
+    size_t done = b58_decode_groups(codec, chunk->digits + chunk->head, chunk->groups, (unsigned char *) chunk->output,
+                                    &chunk->written);
+    chunk->overflow = (done != chunk->groups) ? done : SIZE_MAX;
+}
+
+static void *worker_thread(void *argument) {
+    struct pipeline *pipeline = argument;
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;) {
+        struct chunk *chunk = NULL;
+        while (!pipeline->abort && !pipeline->all_taken) {
+            chunk = &pipeline->chunks[pipeline->next_work % pipeline->slots];
+            if (chunk->state == chunk_read && chunk->sequence == pipeline->next_work) { break; }
+            wait_changed(pipeline);
+        }
+        if (pipeline->abort || pipeline->all_taken) { break; }
+        chunk->state = chunk_working;
+        pipeline->next_work++;
+        pipeline->all_taken = chunk->last;
+        pthread_cond_broadcast(&pipeline->changed);
+        pthread_mutex_unlock(&pipeline->lock);
+
+        if (pipeline->decoding) {
+            decode_chunk(pipeline, chunk);
+        } else {
+            chunk->written = encode_chunk(pipeline->codec, chunk->input, chunk->length, chunk->last, chunk->output);
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        chunk->state = chunk_done;
+        pthread_cond_broadcast(&pipeline->changed);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+/*
+ * Emits one decoded chunk, carry holds the digits of the group left open
+ * by the preceding chunks.
+ */
+static enum b58_result write_decoded(const b58_codec *codec, struct chunk *chunk, unsigned char *carry,
+                                     size_t *carried, size_t *error_offset) {
+    size_t digits = b58_codec_group_digits(codec);
+    memcpy(carry + *carried, chunk->digits, chunk->head);
+    *carried += chunk->head;
+    if (*carried == digits) {
+        unsigned char group[B58_MAX_GROUP_BYTES];
+        size_t written;
+        if (b58_decode_groups(codec, carry, 1, group, &written) != 1) {
+            *error_offset = chunk->offset + b58_digit_offset(codec, (const char *) chunk->input, chunk->head - 1);
+            return b58_invalid;
+        }
+        if (!write_all(STDOUT_FILENO, group, written)) { return b58_write_error; }
+        *carried = 0;
+    }
+    if (!write_all(STDOUT_FILENO, chunk->output, chunk->written)) { return b58_write_error; }
+    if (chunk->overflow != SIZE_MAX) {
+        size_t digit = chunk->head + chunk->overflow * digits + digits - 1;
+        *error_offset = chunk->offset + b58_digit_offset(codec, (const char *) chunk->input, digit);
+        return b58_invalid;
+    }
+    if (chunk->invalid != chunk->length) {
+        *error_offset = chunk->offset + chunk->invalid;
+        return b58_invalid;
+    }
+    size_t tail = chunk->count - chunk->head - chunk->groups * digits;
+    memcpy(carry + *carried, chunk->digits + chunk->count - tail, tail);
+    *carried += tail;
+    if (chunk->last && *carried != 0) {
+        *error_offset = chunk->offset + chunk->length;
+        return b58_invalid;
+    }
+    return b58_ok;
+}
+
+static bool allocate_chunks(struct pipeline *pipeline) {
+    for (size_t i = 0; i < pipeline->slots; i++) {
+        struct chunk *chunk = &pipeline->chunks[i];
+        chunk->input = malloc(INPUT_CHUNK);
+        chunk->digits = malloc(INPUT_CHUNK);
+        chunk->output = malloc(OUTPUT_CHUNK);
+        if (!chunk->input || !chunk->digits || !chunk->output) { return false; }
+    }
+    return true;
+}
+
+static void free_chunks(struct pipeline *pipeline) {
+    for (size_t i = 0; i < pipeline->slots; i++) {
+        free(pipeline->chunks[i].input);
+        free(pipeline->chunks[i].digits);
+        free(pipeline->chunks[i].output);
+    }
+    free(pipeline->chunks);
+}
+
+enum b58_result transform_parallel(const b58_codec *codec, bool decoding, size_t threads, size_t *error_offset) {
+    struct pipeline pipeline = {.codec = codec, .decoding = decoding, .slots = 2 * threads + 2};
+    pipeline.chunks = calloc(pipeline.slots, sizeof(struct chunk));
+    if (!pipeline.chunks || !allocate_chunks(&pipeline) || pipe(pipeline.wake) != 0) {
+        if (pipeline.chunks) { free_chunks(&pipeline); }
+        fprintf(stderr, "Failed to allocate chunk buffers!\n");
+        return b58_write_error;
+    }
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.changed, NULL);
+
+    pthread_t reader, *workers = malloc(threads * sizeof(pthread_t));
+    size_t started = 0;
+    bool running = workers && pthread_create(&reader, NULL, reader_thread, &pipeline) == 0;
+    while (running && started < threads && pthread_create(&workers[started], NULL, worker_thread, &pipeline) == 0) {
+        started++;
+    }
+
+    enum b58_result result = (running && started > 0) ? b58_ok : b58_write_error;
+    unsigned char carry[B58_MAX_GROUP_DIGITS];
+    size_t carried = 0;
+    for (size_t sequence = 0; result == b58_ok; sequence++) {
+        struct chunk *chunk = &pipeline.chunks[sequence % pipeline.slots];
+        pthread_mutex_lock(&pipeline.lock);
+        while (chunk->state != chunk_done || chunk->sequence != sequence) { wait_changed(&pipeline); }
+        pthread_mutex_unlock(&pipeline.lock);
+
+        if (decoding) {
+            result = write_decoded(codec, chunk, carry, &carried, error_offset);
+        } else if (!write_all(STDOUT_FILENO, chunk->output, chunk->written)) {
+            result = b58_write_error;
+        }
+        if (chunk->last) { break; }
+        set_state(&pipeline, chunk, chunk_free);
+    }
+
+    pthread_mutex_lock(&pipeline.lock);
+    pipeline.abort = true;
+    pthread_cond_broadcast(&pipeline.changed);
+    pthread_mutex_unlock(&pipeline.lock);
+    // the reader may be blocked on its input after an error, the wake pipe releases it
+    while (write(pipeline.wake[1], "", 1) < 0 && errno == EINTR) {}
+    for (size_t i = 0; i < started; i++) { pthread_join(workers[i], NULL); }
+    free(workers);
+    if (running) { pthread_join(reader, NULL); }
+    close(pipeline.wake[0]);
+    close(pipeline.wake[1]);
+    pthread_cond_destroy(&pipeline.changed);
+    pthread_mutex_destroy(&pipeline.lock);
+    free_chunks(&pipeline);
+    return result;
+}
+
+/* ************************************************************** *
+ *                       Whole-buffer modes                       *
+ * ************************************************************** */
+
+/*
+ * The whole input as one buffer, mapped when possible.
+ */
+static unsigned char *read_all(struct source *source, size_t *length) {
+    if (source->mapped) {
+        *length = source->length;
+        return (unsigned char *) source->mapped;
+    }
+    size_t capacity = INPUT_CHUNK, count;
+    unsigned char *buffer = source->buffer;
+    source->buffer = NULL;
+    *length = 0;
+    while (buffer && (count = read_full(source->fd, buffer + *length, capacity - *length)) > 0) {
+        *length += count;
+        if (*length < capacity) { continue; }
+        unsigned char *larger = realloc(buffer, capacity * 2);
+        if (!larger) { free(buffer); }
+        buffer = larger;
+        capacity *= 2;
+    }
+    return buffer;
+}
+
+/*
+ * Bitcoin-style encoding of the input as one number (-b), optionally
+ * with the Base58Check checksum (-c).
+ */
+enum b58_result transform_whole(const b58_codec *codec, bool decoding, bool check, int input, int output,
+                                size_t *error_offset) {
+    struct source source;
+    size_t length = 0;
+    unsigned char *in = source_open(&source, input) ? read_all(&source, &length) : NULL;
+    size_t encoded = length + (check ? 4 : 0);
+    uint32_t *limbs = malloc(b58_bignum_limbs(encoded) * sizeof(uint32_t));
+    unsigned char *out = malloc(decoding ? b58_bignum_decoded_size(length) + 1 : b58_bignum_encoded_size(encoded) + 1);
+
+    enum b58_result result = b58_ok;
+    size_t written = 0;
+    if (!in || !limbs || !out) {
+        fprintf(stderr, "Failed to allocate buffers!\n");
+        result = b58_write_error;
+    } else if (!decoding) {
+        if (check) {
+            written = b58_check_encode(codec, in, length, limbs, (char *) out);
+        } else {
+            written = b58_bignum_encode(codec, in, length, limbs, (char *) out);
+        }
+        out[written++] = '\n';
+    } else if (check) {
+        result = b58_check_decode(codec, (const char *) in, length, limbs, out, &written);
+    } else if (!b58_bignum_decode(codec, (const char *) in, length, limbs, out, &written)) {
+        result = b58_invalid;
+    }
+    if (result == b58_invalid) { *error_offset = written; }
+    if (result == b58_ok && !write_all(output, out, written)) { result = b58_write_error; }
+
+    if (in != source.mapped) { free(in); }
+    source_close(&source);
+    free(limbs);
+    free(out);
+    return result;
+}
+
+/* ************************************************************** *
+ *                           Batch mode                           *
+ * ************************************************************** */
+
+struct mode {
+    const b58_codec *codec;
+    bool decoding;
+    bool whole;
+    bool check;
+};
+
+static enum b58_result transform(const struct mode *mode, int input, int output, size_t *error_offset) {
+    if (mode->whole) { return transform_whole(mode->codec, mode->decoding, mode->check, input, output, error_offset); }
+    return mode->decoding ? decode(mode->codec, input, output, error_offset) : encode(mode->codec, input, output);
+}
+
+/*
+ * Messages of failed transformations, prefixed by the file name in batch mode.
+ */
+static void report_error(const char *file, enum b58_result result, size_t error_offset) {
+    const char *prefix = file ? file : "", *separator = file ? ": " : "";
+    switch (result) {
+        case b58_invalid:
+            fprintf(stderr, "%s%sInput isn't encoded via Base58! (offset %zu)\n", prefix, separator, error_offset);
+            break;
+        case b58_checksum_error:
+            fprintf(stderr, "%s%sBase58Check checksum doesn't match!\n", prefix, separator);
+            break;
+        case b58_read_error:
+            fprintf(stderr, "%s%sFailed to read input!\n", prefix, separator);
+            break;
+        case b58_write_error:
+            fprintf(stderr, "%s%sFailed to write output!\n", prefix, separator);
+            break;
+        case b58_ok:
+            break;
+    }
+}
+
+/*
+ * Every line of the manifest is "INPUT<TAB>OUTPUT". Workers take the lines
+ * one by one and transform the files in memory, a failure is reported and
+ * its output removed, the rest of the batch goes on.
+ */
+struct batch {
+    pthread_mutex_t lock;
+    FILE *manifest;
+    const struct mode *mode;
+    size_t lines;
+    size_t files;
+    size_t failed;
+};
+
+static enum b58_result transform_file(const struct mode *mode, const char *input, const char *output,
+                                      size_t *error_offset) {
+    int in = open(input, O_RDONLY);
+    if (in < 0) { return b58_read_error; }
+    int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        close(in);
+        return b58_write_error;
+    }
+    enum b58_result result = transform(mode, in, out, error_offset);
+    close(in);
+    if (close(out) != 0 && result == b58_ok) { result = b58_write_error; }
+    if (result != b58_ok) { unlink(output); }
+    return result;
+}
+
+static void *batch_thread(void *argument) {
+    struct batch *batch = argument;
+    char *line = NULL;
+    size_t capacity = 0;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        ssize_t length = getline(&line, &capacity, batch->manifest);
+        size_t number = ++batch->lines;
+        pthread_mutex_unlock(&batch->lock);
+        if (length < 0) { break; }
+
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) { line[--length] = '\0'; }
+        if (length == 0) { continue; }
+        char *output = strchr(line, '\t');
+        bool failed = true;
+        if (!output || output == line || output[1] == '\0') {
+            fprintf(stderr, "Manifest line %zu: expected INPUT<TAB>OUTPUT\n", number);
+        } else {
+            *output++ = '\0';
+            size_t error_offset = 0;
+            enum b58_result result = transform_file(batch->mode, line, output, &error_offset);
+            report_error(line, result, error_offset);
+            failed = result != b58_ok;
+        }
+
+        pthread_mutex_lock(&batch->lock);
+        batch->files++;
+        batch->failed += failed;
+        pthread_mutex_unlock(&batch->lock);
+    }
+    free(line);
+    return NULL;
+}
+
+/*
+ * Reads the manifest from the file, or from stdin if there is none.
+ */
+static bool transform_batch(const struct mode *mode, const char *manifest, size_t threads) {
+    struct batch batch = {.mode = mode, .manifest = manifest ? fopen(manifest, "r") : stdin};
+    if (!batch.manifest) {
+        fprintf(stderr, "Failed to open manifest %s\n", manifest);
+        return false;
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    size_t started = 0;
+    while (workers && started < threads && pthread_create(&workers[started], NULL, batch_thread, &batch) == 0) {
+        started++;
+    }
+    if (started == 0) { batch_thread(&batch); }
+    for (size_t i = 0; i < started; i++) { pthread_join(workers[i], NULL); }
+    free(workers);
+    pthread_mutex_destroy(&batch.lock);
+
+    bool read = !ferror(batch.manifest);
+    if (!read) { fprintf(stderr, "Failed to read the manifest!\n"); }
+    if (batch.manifest != stdin) { fclose(batch.manifest); }
+    if (batch.failed > 0) { fprintf(stderr, "%zu of %zu files failed\n", batch.failed, batch.files); }
+    return read && batch.failed == 0;
+}
+
+int main(int argc, char **argv) {
+    struct mode mode = {0};
+    bool batch = false;
+    const char *alphabet = "bitcoin", *manifest = NULL;
+    size_t threads = 0, group_bytes = 4;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-e")) {
+            mode.decoding = false;
+        } else if (!strcmp(argv[i], "-d")) {
+            mode.decoding = true;
+        } else if (!strcmp(argv[i], "-b")) {
+            mode.whole = true;
+        } else if (!strcmp(argv[i], "-c")) {
+            mode.whole = true;
+            mode.check = true;
+        } else if (!strcmp(argv[i], "--batch")) {
+            batch = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') { manifest = argv[++i]; }
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            char *end = NULL;
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || end == argv[i] || value < 1 || value > 1024) {
+                fprintf(stderr, "Invalid number of threads %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            threads = (size_t) value;
+        } else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+            alphabet = argv[++i];
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            char *end = NULL;
+            long value = strtol(argv[++i], &end, 10);
+            group_bytes = (*end != '\0' || end == argv[i] || value < 1) ? 0 : (size_t) value;
+        } else {
+            fprintf(stderr, "Invalid switch, use -e or -d, optionally with -j N, -a ALPHABET, -w BYTES, -b, -c"
+                            " or --batch [MANIFEST]\n");
+            return EXIT_FAILURE;
+        }
+    }
+    mode.codec = b58_codec_find(alphabet, group_bytes);
+    if (!mode.codec) {
+        fprintf(stderr, "Unsupported codec, use -a bitcoin, ripple or flickr and -w 1, 2, 4 or 8\n");
+        return EXIT_FAILURE;
+    }
+
+    if (batch) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads == 0) { threads = (processors > 0) ? (size_t) processors : 1; }
+        return transform_batch(&mode, manifest, threads) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    size_t error_offset = 0;
+    enum b58_result result;
+    if (threads > 1 && !mode.whole) {
+        result = transform_parallel(mode.codec, mode.decoding, threads, &error_offset);
+    } else {
+        result = transform(&mode, STDIN_FILENO, STDOUT_FILENO, &error_offset);
+    }
+    report_error(NULL, result, error_offset);
+    return (result == b58_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file sha256.h
+ * @brief SHA-256 (FIPS 180-4), as needed by the Base58Check checksum.
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_LENGTH 32
+
+typedef struct sha256_ctx
+{
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char buffer[64];
+    size_t buffered;
+} sha256_ctx;
+
+/**
+ * @brief Initialize the context for a new message.
+ */
+void sha256_init(sha256_ctx *ctx);
+
+/**
+ * @brief Hash the next size bytes of the message.
+ */
+void sha256_update(sha256_ctx *ctx, const void *data, size_t size);
+
+/**
+ * @brief Finish the message and store its digest.
+ */
+void sha256_final(sha256_ctx *ctx, unsigned char digest[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Digest of the whole message at once.
+ */
+void sha256(const void *data, size_t size, unsigned char digest[SHA256_DIGEST_LENGTH]);
+
+#endif //SHA256_H
@@ -0,0 +1,324 @@
+#include "batch.h"
+#include "cache.h"
+#include "lockstep.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* sudokus a worker takes at once, and sudokus read while the previous round is being solved */
+#define CHUNK 256
+#define CHUNKS_PER_THREAD 16
+/* generating one takes milliseconds, workers take them one by one */
+#define GENERATE_CHUNK 1
+
+#define LINE_LENGTH 81
+
+struct record {
+    unsigned int sudoku[9][9];
+    unsigned long line;
+    bool loaded, solved;
+    /* equivalent to an earlier sudoku of its chunk, answered from the cache once that one is solved */
+    bool repeated;
+};
+
+struct round {
+    struct record *records;
+    size_t count;
+};
+
+struct pool;
+
+/* fills the records of a chunk */
+typedef void (*chunk_function)(const struct pool *pool, struct record *records, size_t count);
+
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    chunk_function work;
+    size_t chunk;
+    sudoku_solver solver;
+    bool lockstep;
+    /* solutions of equivalent sudokus, NULL if not used */
+    struct cache *cache;
+    /* mapped packed corpus the workers unpack their records from by index, NULL if they are read for them */
+    const struct corpus *packed;
+    /* parameters of generate_puzzle(), record lines are puzzle indices */
+    uint64_t seed;
+    int clues, level;
+
+    /* records of the current round, workers take chunks from next */
+    struct round round;
+    size_t next, done;
+    bool finished;
+};
+
+static bool unsolved(const struct record *record) {
+    return record->loaded && !record->solved && !record->repeated;
+}
+
+/* eliminates in groups of LOCKSTEP_LANES sudokus, the solver only gets those left open */
+static void solve_lockstep(sudoku_solver solver, struct record *records, size_t count) {
+    struct record *group[LOCKSTEP_LANES];
+    unsigned int (*sudokus[LOCKSTEP_LANES])[9];
+    enum lockstep_result results[LOCKSTEP_LANES];
+    size_t lanes = 0;
+    for (size_t i = 0; i <= count; i++) {
+        if (i < count && unsolved(&records[i])) {
+            group[lanes] = &records[i];
+            sudokus[lanes++] = records[i].sudoku;
+        }
+        if (lanes == LOCKSTEP_LANES || (i == count && lanes > 0)) {
+            lockstep_propagate(sudokus, lanes, results);
+            for (size_t lane = 0; lane < lanes; lane++) {
+                group[lane]->solved = results[lane] == lockstep_solved
+                                      || (results[lane] == lockstep_open && solver(sudokus[lane]));
+            }
+            lanes = 0;
+        }
+    }
+}
+
+static void generate_chunk(const struct pool *pool, struct record *records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        /* independent stream of every puzzle, the output does not depend on threads */
+        uint64_t seed = pool->seed ^ (records[i].line * 0xD1B54A32D192ED03u);
+        records[i].solved = generate_puzzle(records[i].sudoku, seed, pool->clues, pool->level);
+    }
+}
+
+static void solve_chunk(const struct pool *pool, struct record *records, size_t count) {
+    for (size_t i = 0; pool->packed && i < count; i++) {
+        records[i].loaded = corpus_get(pool->packed, records[i].line - 1, records[i].sudoku);
+    }
+
+    /* sudokus found in the cache are solved already, the others keep their keys to be stored */
+    struct cache_key keys[CHUNK];
+    for (size_t i = 0; pool->cache && i < count; i++) {
+        if (records[i].loaded && cache_lookup(pool->cache, records[i].sudoku, &keys[i])) {
+            records[i].solved = true;
+            keys[i].usable = false;
+        }
+        for (size_t k = 0; k < i && unsolved(&records[i]) && keys[i].usable; k++) {
+            records[i].repeated = unsolved(&records[k]) && keys[k].usable && keys[k].hash == keys[i].hash
+                                  && memcmp(keys[k].form, keys[i].form, sizeof(keys[i].form)) == 0;
+        }
+    }
+
+    if (pool->lockstep) {
+        solve_lockstep(pool->solver, records, count);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            if (unsolved(&records[i])) { records[i].solved = pool->solver(records[i].sudoku); }
+        }
+    }
+
+    for (size_t i = 0; pool->cache && i < count; i++) {
+        if (records[i].loaded && records[i].solved) { cache_store(pool->cache, &keys[i], records[i].sudoku); }
+    }
+    /* the solver gets them if the earlier one has no solution or the table is full */
+    for (size_t i = 0; pool->cache && i < count; i++) {
+        if (records[i].repeated) {
+            records[i].repeated = false;
+            records[i].solved = cache_find(pool->cache, &keys[i], records[i].sudoku)
+                                || pool->solver(records[i].sudoku);
+        }
+    }
+}
+
+static void *worker_thread(void *data) {
+    struct pool *pool = data;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->finished && pool->next >= pool->round.count) {
+            pthread_cond_wait(&pool->changed, &pool->lock);
+        }
+        if (pool->finished) { break; }
+
+        size_t first = pool->next;
+        size_t count = pool->round.count - first < pool->chunk ? pool->round.count - first : pool->chunk;
+        struct record *records = pool->round.records + first;
+        pool->next += count;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->work(pool, records, count);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->done += count;
+        if (pool->done == pool->round.count) { pthread_cond_broadcast(&pool->changed); }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void start_round(struct pool *pool, struct round round) {
+    pthread_mutex_lock(&pool->lock);
+    pool->round = round;
+    pool->next = pool->done = 0;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void finish_round(struct pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->done < pool->round.count) { pthread_cond_wait(&pool->changed, &pool->lock); }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Reads up to capacity records, failed is set if reading the input failed.
+ * Records of a mapped packed corpus only get their indices from indexed,
+ * the workers unpack them.
+ */
+static size_t read_round(struct corpus *in, struct record *records, size_t capacity, unsigned long *indexed,
+                         bool *failed) {
+    size_t count = 0;
+    while (count < capacity) {
+        struct record *record = &records[count];
+        if (indexed) {
+            if (*indexed == corpus_count(in)) { break; }
+            record->line = ++*indexed;
+            record->loaded = true;
+        } else {
+            enum corpus_status status = corpus_next(in, record->sudoku, &record->line);
+            if (status == corpus_end || status == corpus_failed) {
+                *failed |= status == corpus_failed;
+                break;
+            }
+            record->loaded = status == corpus_loaded;
+        }
+        record->solved = false;
+        record->repeated = false;
+        count++;
+    }
+    return count;
+}
+
+static bool write_round(FILE *out, const struct round *round, bool generated) {
+    bool all_solved = true;
+    char line[LINE_LENGTH + 1];
+    line[LINE_LENGTH] = '\n';
+    for (size_t i = 0; i < round->count; i++) {
+        const struct record *record = &round->records[i];
+        if (!record->loaded) {
+            fprintf(stderr, "Line %lu: failed to load input\n", record->line);
+            all_solved = false;
+            fputc('\n', out);
+            continue;
+        }
+        if (!record->solved) {
+            fprintf(stderr, generated ? "Sudoku %lu: none found\n" : "Line %lu: no solution\n", record->line);
+            all_solved = false;
+        }
+        for (int j = 0; j < 81; j++) {
+            unsigned int cell = record->sudoku[j / 9][j % 9];
+            int digit = 0;
+            if (cell != 0 && !(cell & (cell - 1))) {
+                while (cell >>= 1) { digit++; }
+                digit++;
+            }
+            line[j] = (char) ('0' + digit);
+        }
+        fwrite(line, 1, sizeof(line), out);
+    }
+    return all_solved;
+}
+
+static bool start_pool(struct pool *pool, pthread_t *workers, int threads, int *started) {
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->changed, NULL);
+    *started = 0;
+    while (*started < threads && pthread_create(&workers[*started], NULL, worker_thread, pool) == 0) {
+        ++*started;
+    }
+    if (*started == 0) { fprintf(stderr, "Failed to start worker threads\n"); }
+    return *started > 0;
+}
+
+static void stop_pool(struct pool *pool, pthread_t *workers, int started) {
+    pthread_mutex_lock(&pool->lock);
+    pool->finished = true;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_cond_destroy(&pool->changed);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+bool batch_solve(struct corpus *in, FILE *out, sudoku_solver solver, int threads, bool lockstep, struct cache *cache) {
+    size_t capacity = (size_t) threads * CHUNK * CHUNKS_PER_THREAD;
+    struct record *buffers[2] = {malloc(capacity * sizeof(struct record)), malloc(capacity * sizeof(struct record))};
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    if (!buffers[0] || !buffers[1] || !workers) {
+        fprintf(stderr, "Out of memory\n");
+        free(buffers[0]);
+        free(buffers[1]);
+        free(workers);
+        return false;
+    }
+
+    struct pool pool = {.work = solve_chunk, .chunk = CHUNK, .solver = solver,
+                        .lockstep = lockstep && lockstep_supported(), .cache = cache,
+                        .packed = corpus_count(in) > 0 ? in : NULL};
+    int started;
+    bool all_solved = start_pool(&pool, workers, threads, &started);
+    bool failed = false;
+    unsigned long index = 0, *indexed = pool.packed ? &index : NULL;
+    if (all_solved) {
+        /* the next round is read while the current one is being solved */
+        struct round current = {buffers[0], read_round(in, buffers[0], capacity, indexed, &failed)};
+        int spare = 1;
+        while (current.count > 0) {
+            start_round(&pool, current);
+            struct round next = {buffers[spare], read_round(in, buffers[spare], capacity, indexed, &failed)};
+            finish_round(&pool);
+            all_solved &= write_round(out, &current, false);
+            current = next;
+            spare ^= 1;
+        }
+        if (failed) {
+            fprintf(stderr, "Failed to read input\n");
+            all_solved = false;
+        }
+    }
+
+    stop_pool(&pool, workers, started);
+    free(buffers[0]);
+    free(buffers[1]);
+    free(workers);
+    return all_solved;
+}
+
+bool batch_generate(FILE *out, unsigned long count, uint64_t seed, int clues, int level, int threads) {
+    size_t capacity = (size_t) threads * GENERATE_CHUNK * CHUNKS_PER_THREAD;
+    struct record *records = malloc(capacity * sizeof(struct record));
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    if (!records || !workers) {
+        fprintf(stderr, "Out of memory\n");
+        free(records);
+        free(workers);
+        return false;
+    }
+
+    struct pool pool = {.work = generate_chunk, .chunk = GENERATE_CHUNK, .seed = seed, .clues = clues, .level = level};
+    int started;
+    bool all_generated = start_pool(&pool, workers, threads, &started);
+    for (unsigned long first = 1; all_generated && first <= count; first += capacity) {
+        struct round round = {records, count - first + 1 < capacity ? count - first + 1 : capacity};
+        for (size_t i = 0; i < round.count; i++) {
+            records[i].line = first + i;
+            records[i].loaded = true;
+        }
+        start_round(&pool, round);
+        finish_round(&pool);
+        all_generated &= write_round(out, &round, true);
+    }
+
+    stop_pool(&pool, workers, started);
+    free(records);
+    free(workers);
+    return all_generated;
+}
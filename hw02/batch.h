@@ -0,0 +1,55 @@
+/**
+ * @file batch.h
+ * @brief Solving and generating of many sudokus over a pool of threads.
+ *
+ * The input is a corpus (see corpus.h): sudokus of 81 characters per
+ * line, '0' or '.' being an unknown digit, or grids as print() writes
+ * them. Every sudoku of input gives one line of output in the same
+ * order: the solved sudoku in 81 characters, or the state the solver
+ * ended in with '0' for cells that are not unique. The workers unpack the
+ * sudokus of a mapped packed corpus themselves, by index.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "cache.h"
+#include "corpus.h"
+#include "sudoku.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Solve all sudokus of the input.
+ *
+ * Malformed records and sudokus without solution are reported on STDERR
+ * with their line numbers, a malformed one gives an empty line of
+ * output; the run goes on with the next record.
+ *
+ * @param solver reentrant solver, e.g. backtrack_solve()
+ * @param threads number of worker threads, at least 1
+ * @param lockstep eliminate in SIMD lanes first (see lockstep.h) if the
+ * CPU supports it, the solver then gets only sudokus left unsolved
+ * @param cache sudokus equivalent to ones solved before are answered
+ * from it and new solutions are added to it, NULL for none
+ * @return true if every sudoku was solved
+ */
+bool batch_solve(struct corpus *in, FILE *out, sudoku_solver solver, int threads, bool lockstep, struct cache *cache);
+
+/**
+ * @brief Generate count sudokus with unique solutions, see generate_puzzle().
+ *
+ * Every sudoku has its own random stream derived from the seed and its
+ * index, so the output is the same for any number of threads. One line
+ * per sudoku is written in the format of batch_solve() input.
+ *
+ * @param clues at most this many digits are left, 0 for as few as possible
+ * @param level required enum grade value, -1 for any
+ * @param threads number of worker threads, at least 1
+ * @return true if all sudokus were generated
+ */
+bool batch_generate(FILE *out, unsigned long count, uint64_t seed, int clues, int level, int threads);
+
+#endif //BATCH_H
@@ -0,0 +1,213 @@
+#include "cache.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "SUDOKUC1"
+/* entries tried before a lookup gives up */
+#define PROBES 32
+/* bytes of 81 cells packed two per byte */
+#define PACKED 41
+
+struct header {
+    char magic[8];
+    uint64_t capacity, count;
+};
+
+/* hash 0 marks an empty entry */
+struct entry {
+    uint64_t hash;
+    unsigned char form[PACKED], solution[PACKED];
+};
+
+struct cache {
+    pthread_mutex_t lock;
+    struct header *header;
+    struct entry *entries;
+    /* bytes mapped from the file, 0 for a table in memory */
+    size_t mapped;
+};
+
+static size_t table_size(void) {
+    return sizeof(struct header) + CACHE_CAPACITY * sizeof(struct entry);
+}
+
+static struct cache *cache_wrap(void *table, size_t mapped) {
+    struct cache *cache = malloc(sizeof(struct cache));
+    if (!cache) { return NULL; }
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->header = table;
+    cache->entries = (struct entry *) (cache->header + 1);
+    cache->mapped = mapped;
+    return cache;
+}
+
+struct cache *cache_create(void) {
+    /* calloc() of this size gets untouched zero pages, they are filled as they are used */
+    struct header *header = calloc(1, table_size());
+    struct cache *cache = header ? cache_wrap(header, 0) : NULL;
+    if (!cache) {
+        free(header);
+        return NULL;
+    }
+    memcpy(header->magic, MAGIC, sizeof(header->magic));
+    header->capacity = CACHE_CAPACITY;
+    return cache;
+}
+
+struct cache *cache_open(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        perror(path);
+        if (fd >= 0) { close(fd); }
+        return NULL;
+    }
+    bool created = status.st_size == 0;
+    if (created && ftruncate(fd, (off_t) table_size()) != 0) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+    if (!created && (size_t) status.st_size != table_size()) {
+        fprintf(stderr, "%s: not a sudoku cache\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *table = mmap(NULL, table_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    /* the mapping stays valid without the descriptor */
+    close(fd);
+    if (table == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+    struct header *header = table;
+    if (created) {
+        memcpy(header->magic, MAGIC, sizeof(header->magic));
+        header->capacity = CACHE_CAPACITY;
+    } else if (memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0 || header->capacity != CACHE_CAPACITY) {
+        fprintf(stderr, "%s: not a sudoku cache\n", path);
+        munmap(table, table_size());
+        return NULL;
+    }
+
+    struct cache *cache = cache_wrap(table, table_size());
+    if (!cache) { munmap(table, table_size()); }
+    return cache;
+}
+
+void cache_close(struct cache *cache) {
+    if (!cache) { return; }
+    if (cache->mapped) {
+        munmap(cache->header, cache->mapped);
+    } else {
+        free(cache->header);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/* digits 0 to 9 of the cells, false unless every cell is unique or unknown */
+static bool to_digits(unsigned int sudoku[9][9], unsigned char digits[81], bool unknown) {
+    for (int i = 0; i < 81; i++) {
+        unsigned int cell = sudoku[i / 9][i % 9];
+        if (unknown && cell == 511) {
+            digits[i] = 0;
+            continue;
+        }
+        if (cell == 0 || (cell & (cell - 1))) { return false; }
+        for (digits[i] = 1; cell >>= 1;) { digits[i]++; }
+    }
+    return true;
+}
+
+static void pack(const unsigned char digits[81], unsigned char packed[PACKED]) {
+    memset(packed, 0, PACKED);
+    for (int i = 0; i < 81; i++) {
+        packed[i / 2] |= (unsigned char) (digits[i] << (i % 2 * 4));
+    }
+}
+
+static void unpack(const unsigned char packed[PACKED], unsigned char digits[81]) {
+    for (int i = 0; i < 81; i++) {
+        digits[i] = (packed[i / 2] >> (i % 2 * 4)) & 15u;
+    }
+}
+
+/* FNV-1a */
+static uint64_t form_hash(const unsigned char form[81]) {
+    uint64_t hash = 0xCBF29CE484222325u;
+    for (int i = 0; i < 81; i++) {
+        hash = (hash ^ form[i]) * 0x100000001B3u;
+    }
+    return hash ? hash : 1;
+}
+
+bool cache_lookup(struct cache *cache, unsigned int sudoku[9][9], struct cache_key *key) {
+    unsigned char digits[81];
+    key->usable = to_digits(sudoku, digits, true);
+    if (!key->usable) { return false; }
+    canonical_form(digits, key->form, &key->symmetry);
+    key->hash = form_hash(key->form);
+    return cache_find(cache, key, sudoku);
+}
+
+bool cache_find(struct cache *cache, const struct cache_key *key, unsigned int sudoku[9][9]) {
+    if (!key->usable) { return false; }
+    unsigned char form[PACKED], solution[PACKED];
+    bool found = false;
+    pack(key->form, form);
+    pthread_mutex_lock(&cache->lock);
+    for (uint64_t probe = 0; probe < PROBES; probe++) {
+        const struct entry *entry = &cache->entries[(key->hash + probe) & (CACHE_CAPACITY - 1)];
+        if (entry->hash == 0) { break; }
+        if (entry->hash == key->hash && memcmp(entry->form, form, PACKED) == 0) {
+            memcpy(solution, entry->solution, PACKED);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if (!found) { return false; }
+
+    unsigned char digits[81], mapped[81];
+    unpack(solution, digits);
+    for (int i = 0; i < 81; i++) {
+        /* a damaged file */
+        if (digits[i] < 1 || digits[i] > 9) { return false; }
+    }
+    revert_symmetry(&key->symmetry, digits, mapped);
+    for (int i = 0; i < 81; i++) {
+        sudoku[i / 9][i % 9] = 1u << (mapped[i] - 1);
+    }
+    return true;
+}
+
+void cache_store(struct cache *cache, const struct cache_key *key, unsigned int solution[9][9]) {
+    unsigned char digits[81], mapped[81];
+    if (!key->usable || !to_digits(solution, digits, false)) { return; }
+    apply_symmetry(&key->symmetry, digits, mapped);
+
+    struct entry stored = {.hash = key->hash};
+    pack(key->form, stored.form);
+    pack(mapped, stored.solution);
+    pthread_mutex_lock(&cache->lock);
+    /* probes stay short at three quarters full */
+    for (uint64_t probe = 0; cache->header->count < CACHE_CAPACITY / 4 * 3 && probe < PROBES; probe++) {
+        struct entry *entry = &cache->entries[(key->hash + probe) & (CACHE_CAPACITY - 1)];
+        if (entry->hash == 0) {
+            *entry = stored;
+            cache->header->count++;
+            break;
+        }
+        if (entry->hash == key->hash && memcmp(entry->form, stored.form, PACKED) == 0) { break; }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,84 @@
+/**
+ * @file cache.h
+ * @brief Solutions of sudokus keyed by their canonical form.
+ *
+ * A sudoku is looked up by its canonical form (see canon.h), a cached
+ * solution is mapped back through the symmetry, so every sudoku
+ * equivalent to a solved one is answered without a search. The table is
+ * an open addressing hash table of CACHE_CAPACITY entries, either in
+ * memory or in a file mapped by mmap() that later runs reuse. The file
+ * is in the byte order of the machine and is used by one process at a
+ * time.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "canon.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** entries of a table, a power of two */
+#define CACHE_CAPACITY (1u << 18)
+
+struct cache;
+
+/** canonical form of a sudoku between lookup and store */
+struct cache_key {
+    /** false if the sudoku cannot be cached, it has cells reduced to some candidates */
+    bool usable;
+    uint64_t hash;
+    unsigned char form[81];
+    struct symmetry symmetry;
+};
+
+/**
+ * @brief Create an empty table in memory.
+ *
+ * @return NULL if out of memory
+ */
+struct cache *cache_create(void);
+
+/**
+ * @brief Map a table file, created empty if it does not exist.
+ *
+ * @return NULL if the file cannot be mapped or is not a table, reported
+ * on STDERR
+ */
+struct cache *cache_open(const char *path);
+
+/**
+ * @brief Release the table, a file keeps the entries.
+ */
+void cache_close(struct cache *cache);
+
+/**
+ * @brief Look the sudoku up, thread safe.
+ *
+ * Only sudokus of clues and unknown cells (511) are cached.
+ *
+ * @param sudoku 2D array of digit bitsets, holds the solution on a hit
+ * @param key for cache_store() on a miss
+ * @return true on a hit
+ */
+bool cache_lookup(struct cache *cache, unsigned int sudoku[9][9], struct cache_key *key);
+
+/**
+ * @brief Look a key of cache_lookup() up again, after a solution of an
+ * equivalent sudoku was stored, thread safe.
+ *
+ * @param sudoku the sudoku of the key, holds the solution on a hit
+ * @return true on a hit
+ */
+bool cache_find(struct cache *cache, const struct cache_key *key, unsigned int sudoku[9][9]);
+
+/**
+ * @brief Remember the solution of the sudoku the key was made of, thread
+ * safe. Nothing is stored once the table is nearly full.
+ *
+ * @param solution 2D array of unique digit bitsets
+ */
+void cache_store(struct cache *cache, const struct cache_key *key, unsigned int solution[9][9]);
+
+#endif //CACHE_H
@@ -0,0 +1,271 @@
+#include "canon.h"
+
+#include <string.h>
+
+/* key of a digit not numbered yet, it orders after the others */
+#define FRESH 10
+/* columns within every stack */
+#define STACKS_TIED 0x1B6u
+
+static const unsigned char PERMUTATIONS[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+static const unsigned char SWAPS[2][2] = {{0, 1}, {1, 0}};
+
+/* one arrangement, rows of the form are chosen up to a depth */
+struct candidate {
+    struct symmetry symmetry;
+    /* source rows already taken, as bits */
+    unsigned int used;
+    /* bit j if columns at j - 1 and j are still interchangeable: the same stack, unknown in every row so far */
+    unsigned int tied;
+    /* digits[] of the symmetry is filled in order of first appearance */
+    unsigned char next_digit;
+};
+
+struct ties {
+    struct candidate candidates[CANON_TIES];
+    int count;
+    /* the least row found at this depth */
+    unsigned char row[9];
+};
+
+/* the sudoku and its transposition */
+static void load_grids(const unsigned char digits[81], unsigned char grids[2][9][9]) {
+    for (int i = 0; i < 81; i++) {
+        grids[0][i / 9][i % 9] = digits[i];
+        grids[1][i % 9][i / 9] = digits[i];
+    }
+}
+
+/* numbers new digits of the row in order, unties columns that are no longer both unknown */
+static void number_row(struct candidate *candidate, const unsigned char cells[9], unsigned char mapped[9]) {
+    unsigned char *digits = candidate->symmetry.digits;
+    for (int j = 0; j < 9; j++) {
+        unsigned char digit = cells[candidate->symmetry.cols[j]];
+        if (digit && digits[digit] == 0) { digits[digit] = candidate->next_digit++; }
+        mapped[j] = digits[digit];
+        if (j > 0 && (digit || cells[candidate->symmetry.cols[j - 1]])) {
+            candidate->tied &= ~(1u << j);
+        }
+    }
+}
+
+static bool unknown_row(const unsigned char cells[9]) {
+    for (int col = 0; col < 9; col++) {
+        if (cells[col]) { return false; }
+    }
+    return true;
+}
+
+/* true if the row is unknown and so is an earlier row of its band not taken, either of them gives the same */
+static bool repeated_unknown(unsigned char grid[9][9], unsigned int used, int row) {
+    if (!unknown_row(grid[row])) { return false; }
+    for (int earlier = row - row % 3; earlier < row; earlier++) {
+        if (!(used & (1u << earlier)) && unknown_row(grid[earlier])) { return true; }
+    }
+    return false;
+}
+
+/*
+ * Takes the source row as the row of the form at the depth. Within every
+ * run of tied columns, unknown cells go first, digits numbered already
+ * next in order and new digits last, the least the row can be. Returns
+ * the positions of new digits, they get the same numbers in any order.
+ */
+static unsigned int arrange(unsigned char grids[2][9][9], struct candidate *candidate, int depth, int row,
+                            unsigned char mapped[9]) {
+    const unsigned char *cells = grids[candidate->symmetry.transpose][row];
+    const unsigned char *digits = candidate->symmetry.digits;
+    unsigned char *cols = candidate->symmetry.cols;
+    candidate->symmetry.rows[depth] = (unsigned char) row;
+    candidate->used |= 1u << row;
+
+    unsigned char keys[9];
+    for (int col = 0; col < 9; col++) {
+        keys[col] = cells[col] && !digits[cells[col]] ? FRESH : digits[cells[col]];
+    }
+    for (int j = 1; j < 9; j++) {
+        for (int k = j; k > 0 && (candidate->tied & (1u << k)) && keys[cols[k - 1]] > keys[cols[k]]; k--) {
+            unsigned char col = cols[k];
+            cols[k] = cols[k - 1];
+            cols[k - 1] = col;
+        }
+    }
+
+    unsigned int fresh = 0;
+    for (int j = 0; j < 9; j++) {
+        if (keys[cols[j]] == FRESH) { fresh |= 1u << j; }
+    }
+    struct candidate numbered = *candidate;
+    number_row(&numbered, cells, mapped);
+    return fresh;
+}
+
+/* false if the row is greater than the least one, the ties are dropped for a lesser one */
+static bool least_row(struct ties *ties, const unsigned char row[9]) {
+    int order = ties->count ? memcmp(row, ties->row, 9) : -1;
+    if (order > 0) { return false; }
+    if (order < 0) {
+        memcpy(ties->row, row, 9);
+        ties->count = 0;
+    }
+    return true;
+}
+
+static void extend_rows(unsigned char grids[2][9][9], const struct candidate *candidate, int depth,
+                        struct ties *next);
+
+/*
+ * Every order of the new digits at the depth that share a run of tied
+ * columns, from the position on. Each is added to the ties or, for the
+ * first row, extended by the second row right away: the first row ties
+ * the most arrangements and the second one settles nearly all of them.
+ */
+static void add_orders(unsigned char grids[2][9][9], struct ties *ties, const struct candidate *candidate,
+                       int depth, unsigned int fresh, int position) {
+    while (position < 9 && !(fresh & (1u << position))) { position++; }
+    if (position == 9) {
+        struct candidate numbered = *candidate;
+        unsigned char mapped[9];
+        number_row(&numbered, grids[candidate->symmetry.transpose][candidate->symmetry.rows[depth]], mapped);
+        if (depth == 0) {
+            extend_rows(grids, &numbered, 1, ties);
+        } else if (ties->count < CANON_TIES) {
+            ties->candidates[ties->count++] = numbered;
+        }
+        return;
+    }
+
+    int end = position + 1;
+    while (end < 9 && (fresh & (1u << end)) && (candidate->tied & (1u << end))) { end++; }
+    int length = end - position;
+    if (length == 1) {
+        add_orders(grids, ties, candidate, depth, fresh, end);
+        return;
+    }
+    for (int order = 0; order < (length == 2 ? 2 : 6); order++) {
+        const unsigned char *permutation = length == 2 ? SWAPS[order] : PERMUTATIONS[order];
+        struct candidate reordered = *candidate;
+        for (int k = 0; k < length; k++) {
+            reordered.symmetry.cols[position + k] = candidate->symmetry.cols[position + permutation[k]];
+        }
+        add_orders(grids, ties, &reordered, depth, fresh, end);
+    }
+}
+
+/* rows of the form after the first: the rest of its band, then a row of a band not used */
+static void extend_rows(unsigned char grids[2][9][9], const struct candidate *candidate, int depth,
+                        struct ties *next) {
+    unsigned char (*grid)[9] = grids[candidate->symmetry.transpose];
+    int band = candidate->symmetry.rows[depth - 1] / 3;
+    for (int row = 0; row < 9; row++) {
+        if (candidate->used & (1u << row)) { continue; }
+        if (depth % 3 != 0 ? row / 3 != band : (candidate->used >> (row - row % 3)) & 7u) { continue; }
+        if (repeated_unknown(grid, candidate->used, row)) { continue; }
+
+        struct candidate extended = *candidate;
+        unsigned char mapped[9];
+        unsigned int fresh = arrange(grids, &extended, depth, row, mapped);
+        if (least_row(next, mapped)) { add_orders(grids, next, &extended, depth, fresh, 0); }
+    }
+}
+
+/*
+ * The first row numbers its digits 1, 2, ... whatever they are, so the
+ * least one is a row with the fewest clues in a stack, then in the next
+ * stack and the last one. Stacks with fewer of them go first, stacks with
+ * as many go in either order.
+ */
+static void first_rows(unsigned char grids[2][9][9], struct ties *next) {
+    int clues[2][9][3] = {{{0}}};
+    /* clues of the stacks in increasing order, in base 4, lesser for a lesser row */
+    int patterns[2][9], least = 64;
+    for (int transpose = 0; transpose < 2; transpose++) {
+        for (int row = 0; row < 9; row++) {
+            int *counts = clues[transpose][row];
+            for (int col = 0; col < 9; col++) {
+                counts[col / 3] += grids[transpose][row][col] != 0;
+            }
+            int sorted[3] = {counts[0], counts[1], counts[2]};
+            for (int i = 0; i < 2; i++) {
+                for (int k = 0; k < 2 - i; k++) {
+                    if (sorted[k] > sorted[k + 1]) {
+                        int count = sorted[k];
+                        sorted[k] = sorted[k + 1];
+                        sorted[k + 1] = count;
+                    }
+                }
+            }
+            patterns[transpose][row] = sorted[0] * 16 + sorted[1] * 4 + sorted[2];
+            if (patterns[transpose][row] < least) { least = patterns[transpose][row]; }
+        }
+    }
+
+    next->count = 0;
+    for (int transpose = 0; transpose < 2; transpose++) {
+        for (int row = 0; row < 9; row++) {
+            if (patterns[transpose][row] != least || repeated_unknown(grids[transpose], 0, row)) { continue; }
+            const int *counts = clues[transpose][row];
+            for (int order = 0; order < 6; order++) {
+                const unsigned char *stacks = PERMUTATIONS[order];
+                if (counts[stacks[0]] > counts[stacks[1]] || counts[stacks[1]] > counts[stacks[2]]) { continue; }
+                struct candidate candidate = {.symmetry = {.transpose = transpose}, .tied = STACKS_TIED,
+                                              .next_digit = 1};
+                for (int j = 0; j < 9; j++) {
+                    candidate.symmetry.cols[j] = (unsigned char) (stacks[j / 3] * 3 + j % 3);
+                }
+                unsigned char mapped[9];
+                unsigned int fresh = arrange(grids, &candidate, 0, row, mapped);
+                add_orders(grids, next, &candidate, 0, fresh, 0);
+            }
+        }
+    }
+}
+
+void canonical_form(const unsigned char digits[81], unsigned char form[81], struct symmetry *symmetry) {
+    unsigned char grids[2][9][9];
+    /* candidates of the last depth and of the next one */
+    struct ties buffers[2];
+    load_grids(digits, grids);
+
+    first_rows(grids, &buffers[1]);
+    for (int depth = 2; depth < 9; depth++) {
+        const struct ties *ties = &buffers[(depth + 1) % 2];
+        struct ties *next = &buffers[depth % 2];
+        next->count = 0;
+        for (int i = 0; i < ties->count; i++) {
+            extend_rows(grids, &ties->candidates[i], depth, next);
+        }
+    }
+    struct candidate *best = &buffers[0].candidates[0];
+
+    /* digits missing in the sudoku take the numbers left */
+    for (int digit = 1; digit <= 9; digit++) {
+        if (best->symmetry.digits[digit] == 0) { best->symmetry.digits[digit] = best->next_digit++; }
+    }
+    *symmetry = best->symmetry;
+    apply_symmetry(symmetry, digits, form);
+}
+
+void apply_symmetry(const struct symmetry *symmetry, const unsigned char digits[81], unsigned char mapped[81]) {
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            int row = symmetry->rows[i], col = symmetry->cols[j];
+            int source = symmetry->transpose ? col * 9 + row : row * 9 + col;
+            mapped[i * 9 + j] = symmetry->digits[digits[source]];
+        }
+    }
+}
+
+void revert_symmetry(const struct symmetry *symmetry, const unsigned char mapped[81], unsigned char digits[81]) {
+    unsigned char inverse[10];
+    for (int digit = 0; digit <= 9; digit++) {
+        inverse[symmetry->digits[digit]] = (unsigned char) digit;
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            int row = symmetry->rows[i], col = symmetry->cols[j];
+            int source = symmetry->transpose ? col * 9 + row : row * 9 + col;
+            digits[source] = inverse[mapped[i * 9 + j]];
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * @file canon.h
+ * @brief Canonical form of a sudoku under its symmetries.
+ *
+ * Relabelling digits, permuting rows within a band, permuting bands, the
+ * same for columns and stacks, and transposing turn a sudoku into an
+ * equivalent one whose solutions map back the same way. The canonical
+ * form is the least equivalent sudoku read row by row, digits numbered
+ * in order of first appearance and unknown cells (0) less than any digit,
+ * so sparse rows lead and tie with few arrangements.
+ *
+ * Rows of the form are chosen one by one, keeping every arrangement that
+ * ties for the least row so far; columns are ordered within a row as
+ * they are chosen and those still unknown stay interchangeable. Up to
+ * CANON_TIES arrangements are kept past the second row; a sudoku with
+ * more of them may get a form that an equivalent sudoku does not share,
+ * it is still equivalent.
+ */
+
+#ifndef CANON_H
+#define CANON_H
+
+#include <stdbool.h>
+
+/** arrangements of equal prefix followed at once */
+#define CANON_TIES 256
+
+/** maps a sudoku to an equivalent one */
+struct symmetry {
+    /** the sudoku is transposed first */
+    bool transpose;
+    /** row i of the result is row rows[i], column j is column cols[j] */
+    unsigned char rows[9], cols[9];
+    /** digit d becomes digits[d], digits[0] is 0 for unknown cells */
+    unsigned char digits[10];
+};
+
+/**
+ * @brief Find the canonical form of the sudoku.
+ *
+ * @param digits 81 cells row by row, 0 for unknown and 1 to 9
+ * @param form the canonical form in the same format
+ * @param symmetry the map from digits to form
+ */
+void canonical_form(const unsigned char digits[81], unsigned char form[81], struct symmetry *symmetry);
+
+/**
+ * @brief Map a sudoku (or its solution) by the symmetry.
+ */
+void apply_symmetry(const struct symmetry *symmetry, const unsigned char digits[81], unsigned char mapped[81]);
+
+/**
+ * @brief Map a sudoku back, the inverse of apply_symmetry().
+ */
+void revert_symmetry(const struct symmetry *symmetry, const unsigned char mapped[81], unsigned char digits[81]);
+
+#endif //CANON_H
@@ -0,0 +1,371 @@
+#include "corpus.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* bytes of input not mapped kept at once, a longer line is malformed */
+#define WINDOW (1024 * 1024)
+#define LINE_LENGTH 81
+#define GRID_LINES 13
+#define GRID_WIDTH 25
+
+/* packed corpus: magic, count and checksum in little endian, then records */
+#define MAGIC "SUDOKUP1"
+#define HEADER 24
+#define PACKED 41
+
+/* digit bitsets of cell characters, 0 for any other */
+static const unsigned short CELLS[256] = {
+        ['0'] = 511, ['.'] = 511, ['1'] = 1, ['2'] = 2, ['3'] = 4, ['4'] = 8,
+        ['5'] = 16, ['6'] = 32, ['7'] = 64, ['8'] = 128, ['9'] = 256,
+};
+
+/* digit bitsets of packed cells, 0 for 10 to 15 */
+static const unsigned short NIBBLES[16] = {511, 1, 2, 4, 8, 16, 32, 64, 128, 256};
+
+/* lines of a grid, X for a cell */
+static const char BORDER[] = "+-------+-------+-------+";
+static const char ROW[] = "| X X X | X X X | X X X |";
+
+struct corpus {
+    int fd;
+    /* the mapped file or the window, position is the next byte to parse */
+    const char *data;
+    char *buffer;
+    size_t size, position;
+    bool mapped;
+    /* nothing more to read */
+    bool finished, failed;
+    /* the rest of a line longer than the window is dropped */
+    bool overlong;
+    unsigned long line;
+
+    /* records of a packed corpus, index of the next one and checksum of those before */
+    bool packed;
+    uint64_t count, checksum, index, sum;
+};
+
+struct corpus_writer {
+    FILE *file;
+    const char *path;
+    uint64_t count, checksum;
+};
+
+static uint64_t load_le(const unsigned char bytes[8]) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) { value = value << 8 | bytes[i]; }
+    return value;
+}
+
+static void store_le(unsigned char bytes[8], uint64_t value) {
+    for (int i = 0; i < 8; i++) { bytes[i] = (unsigned char) (value >> (i * 8)); }
+}
+
+/* FNV-1a step over the record taken as five 64-bit words and its last byte */
+static uint64_t checksum(uint64_t hash, const unsigned char record[PACKED]) {
+    for (int i = 0; i < PACKED - 1; i += 8) { hash = (hash ^ load_le(record + i)) * 0x100000001B3u; }
+    return (hash ^ record[PACKED - 1]) * 0x100000001B3u;
+}
+
+/* moves the rest of the window to its start and reads more after it, false at the end of input */
+static bool fill(struct corpus *corpus) {
+    if (corpus->finished) { return false; }
+    size_t rest = corpus->size - corpus->position;
+    memmove(corpus->buffer, corpus->buffer + corpus->position, rest);
+    corpus->size = rest;
+    corpus->position = 0;
+
+    ssize_t length;
+    while ((length = read(corpus->fd, corpus->buffer + rest, WINDOW - rest)) < 0 && errno == EINTR) {}
+    if (length <= 0) {
+        corpus->finished = true;
+        corpus->failed = length < 0;
+        return false;
+    }
+    corpus->size += (size_t) length;
+    return true;
+}
+
+/* reads the header if the input is a packed corpus, false if it is damaged */
+static bool detect_packed(struct corpus *corpus, const char *path) {
+    while (corpus->size < HEADER && fill(corpus)) {}
+    if (corpus->size < sizeof(MAGIC) - 1 || memcmp(corpus->data, MAGIC, sizeof(MAGIC) - 1) != 0) { return true; }
+
+    const unsigned char *header = (const unsigned char *) corpus->data;
+    bool complete = corpus->size >= HEADER;
+    if (complete) {
+        corpus->packed = true;
+        corpus->count = load_le(header + 8);
+        corpus->checksum = load_le(header + 16);
+        corpus->sum = 0xCBF29CE484222325u;
+        corpus->position = HEADER;
+    }
+    /* a mapped one is checked whole now so that corpus_get() may read any record, one read as it is read */
+    if (complete && corpus->mapped) {
+        complete = (corpus->size - HEADER) % PACKED == 0 && (corpus->size - HEADER) / PACKED == corpus->count;
+        for (uint64_t i = 0; complete && i < corpus->count; i++) {
+            corpus->sum = checksum(corpus->sum, header + HEADER + i * PACKED);
+        }
+        complete = complete && corpus->sum == corpus->checksum;
+    }
+    if (!complete) { fprintf(stderr, "%s: damaged packed corpus\n", path ? path : "STDIN"); }
+    return complete;
+}
+
+struct corpus *corpus_open(const char *path) {
+    int fd = path ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct corpus *corpus = calloc(1, sizeof(struct corpus));
+    if (!corpus) {
+        fprintf(stderr, "Out of memory\n");
+        if (path) { close(fd); }
+        return NULL;
+    }
+    corpus->fd = fd;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0
+        && (uintmax_t) info.st_size <= SIZE_MAX) {
+        void *mapped = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            posix_madvise(mapped, (size_t) info.st_size, POSIX_MADV_SEQUENTIAL);
+            corpus->data = mapped;
+            corpus->size = (size_t) info.st_size;
+            corpus->mapped = corpus->finished = true;
+        }
+    }
+    if (!corpus->mapped && (corpus->data = corpus->buffer = malloc(WINDOW)) == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        corpus_close(corpus);
+        return NULL;
+    }
+    if (!detect_packed(corpus, path)) {
+        corpus_close(corpus);
+        return NULL;
+    }
+    return corpus;
+}
+
+void corpus_close(struct corpus *corpus) {
+    if (!corpus) { return; }
+    if (corpus->mapped) { munmap((void *) corpus->data, corpus->size); }
+    if (corpus->fd != STDIN_FILENO) { close(corpus->fd); }
+    free(corpus->buffer);
+    free(corpus);
+}
+
+/* the next line without its line break, valid until the next call; false at the end of input */
+static bool next_line(struct corpus *corpus, const char **line, size_t *length) {
+    for (;;) {
+        const char *start = corpus->data + corpus->position;
+        size_t available = corpus->size - corpus->position;
+        const char *end = available ? memchr(start, '\n', available) : NULL;
+        if (corpus->overlong) {
+            corpus->position = end ? (size_t) (end + 1 - corpus->data) : corpus->size;
+            corpus->overlong = !end;
+            if (!end && !fill(corpus)) { return false; }
+            continue;
+        }
+
+        bool full = corpus->position == 0 && corpus->size == WINDOW;
+        if (end || corpus->finished || full) {
+            if (available == 0) { return false; }
+            *line = start;
+            *length = end ? (size_t) (end - start) : available;
+            corpus->position += end ? *length + 1 : available;
+            corpus->overlong = !end && !corpus->finished;
+            corpus->line++;
+            if (*length > 0 && start[*length - 1] == '\r') { --*length; }
+            return true;
+        }
+        fill(corpus);
+    }
+}
+
+/* the first character of the next line, 0 at the end of input */
+static char peek(struct corpus *corpus) {
+    if (corpus->overlong) { return 0; }
+    if (corpus->position == corpus->size && !fill(corpus)) { return 0; }
+    return corpus->data[corpus->position];
+}
+
+static bool parse_line(const char *line, size_t length, unsigned int sudoku[9][9]) {
+    if (length != LINE_LENGTH) { return false; }
+    unsigned int cells[LINE_LENGTH];
+    bool valid = true;
+    for (int i = 0; i < LINE_LENGTH; i++) {
+        cells[i] = CELLS[(unsigned char) line[i]];
+        valid &= cells[i] != 0;
+    }
+    memcpy(sudoku, cells, sizeof(cells));
+    return valid;
+}
+
+/* line index of a grid, borders at 0, 4, 8 and 12 */
+static bool parse_grid_line(const char *line, size_t length, int index, unsigned int sudoku[9][9]) {
+    if (length != GRID_WIDTH) { return false; }
+    if (index % 4 == 0) { return memcmp(line, BORDER, GRID_WIDTH) == 0; }
+
+    unsigned int *cells = sudoku[index - index / 4 - 1];
+    bool valid = true;
+    for (int i = 0, col = 0; i < GRID_WIDTH; i++) {
+        if (ROW[i] == 'X') {
+            cells[col] = CELLS[(unsigned char) line[i]];
+            valid &= cells[col++] != 0;
+        } else {
+            valid &= line[i] == ROW[i];
+        }
+    }
+    return valid;
+}
+
+/* false if a nibble is over 9 or the spare one is not 0, adding 6 carries into bit 4 from 10 up */
+static bool valid_record(const unsigned char record[PACKED]) {
+    uint64_t over = 0;
+    for (int i = 0; i < PACKED - 1; i += 8) {
+        uint64_t word = load_le(record + i);
+        over |= ((word & 0x0F0F0F0F0F0F0F0Fu) + 0x0606060606060606u) | (((word >> 4) & 0x0F0F0F0F0F0F0F0Fu) + 0x0606060606060606u);
+    }
+    return !(over & 0x1010101010101010u) && (record[PACKED - 1] & 15u) <= 9 && record[PACKED - 1] >> 4 == 0;
+}
+
+static bool unpack(const unsigned char *record, unsigned int sudoku[9][9]) {
+    /* filled flat and copied at once, which is faster than a cell at a time into rows */
+    unsigned int cells[82];
+    for (int i = 0; i < PACKED; i++) {
+        cells[2 * i] = NIBBLES[record[i] & 15u];
+        cells[2 * i + 1] = NIBBLES[record[i] >> 4];
+    }
+    memcpy(sudoku, cells, 81 * sizeof(unsigned int));
+    return valid_record(record);
+}
+
+static enum corpus_status next_packed(struct corpus *corpus, unsigned int sudoku[9][9], unsigned long *line) {
+    if (corpus->index == corpus->count || corpus->failed) {
+        /* a mapped one was checked when opened */
+        if (!corpus->failed && !corpus->mapped && corpus->sum != corpus->checksum) {
+            fprintf(stderr, "Packed corpus does not match its checksum\n");
+            corpus->failed = true;
+        } else if (!corpus->failed && !corpus->mapped && (corpus->position < corpus->size || fill(corpus))) {
+            fprintf(stderr, "Packed corpus goes on after %lu sudokus\n", (unsigned long) corpus->count);
+            corpus->failed = true;
+        }
+        return corpus->failed ? corpus_failed : corpus_end;
+    }
+    while (corpus->size - corpus->position < PACKED && fill(corpus)) {}
+    if (corpus->size - corpus->position < PACKED) {
+        if (!corpus->failed) { fprintf(stderr, "Packed corpus ends after %lu sudokus\n", (unsigned long) corpus->index); }
+        corpus->failed = true;
+        return corpus_failed;
+    }
+
+    const unsigned char *record = (const unsigned char *) corpus->data + corpus->position;
+    corpus->position += PACKED;
+    if (!corpus->mapped) { corpus->sum = checksum(corpus->sum, record); }
+    *line = (unsigned long) ++corpus->index;
+    return unpack(record, sudoku) ? corpus_loaded : corpus_malformed;
+}
+
+enum corpus_status corpus_next(struct corpus *corpus, unsigned int sudoku[9][9], unsigned long *line) {
+    if (corpus->packed) { return next_packed(corpus, sudoku, line); }
+    const char *text;
+    size_t length;
+    do {
+        if (!next_line(corpus, &text, &length)) { return corpus->failed ? corpus_failed : corpus_end; }
+    } while (length == 0);
+    *line = corpus->line;
+    if (text[0] != '+') { return parse_line(text, length, sudoku) ? corpus_loaded : corpus_malformed; }
+
+    /* a grid ends early at a line of neither border nor cells, which starts the next record */
+    bool valid = parse_grid_line(text, length, 0, sudoku);
+    for (int index = 1; index < GRID_LINES; index++) {
+        char next = peek(corpus);
+        if ((next != '+' && next != '|') || !next_line(corpus, &text, &length)) { return corpus_malformed; }
+        valid &= parse_grid_line(text, length, index, sudoku);
+    }
+    return valid ? corpus_loaded : corpus_malformed;
+}
+
+size_t corpus_load(struct corpus *corpus, unsigned int sudokus[][9][9], size_t capacity) {
+    size_t count = 0;
+    unsigned long line;
+    while (count < capacity) {
+        enum corpus_status status = corpus_next(corpus, sudokus[count], &line);
+        if (status == corpus_loaded) {
+            count++;
+        } else if (status == corpus_malformed) {
+            fprintf(stderr, "Line %lu: failed to load input\n", line);
+        } else {
+            if (status == corpus_failed) { fprintf(stderr, "Failed to read input\n"); }
+            break;
+        }
+    }
+    return count;
+}
+
+size_t corpus_count(const struct corpus *corpus) {
+    return corpus->packed && corpus->mapped ? (size_t) corpus->count : 0;
+}
+
+bool corpus_get(const struct corpus *corpus, size_t index, unsigned int sudoku[9][9]) {
+    if (!corpus->packed || !corpus->mapped || index >= corpus->count) { return false; }
+    return unpack((const unsigned char *) corpus->data + HEADER + index * PACKED, sudoku);
+}
+
+struct corpus_writer *corpus_create(const char *path) {
+    struct corpus_writer *writer = malloc(sizeof(struct corpus_writer));
+    FILE *file = writer ? fopen(path, "wb") : NULL;
+    if (!writer) {
+        fprintf(stderr, "Out of memory\n");
+        return NULL;
+    }
+    if (!file) {
+        perror(path);
+        free(writer);
+        return NULL;
+    }
+    *writer = (struct corpus_writer) {.file = file, .path = path, .checksum = 0xCBF29CE484222325u};
+    /* the header is written once the count is known */
+    unsigned char header[HEADER] = {0};
+    fwrite(header, 1, HEADER, file);
+    return writer;
+}
+
+bool corpus_write(struct corpus_writer *writer, unsigned int sudoku[9][9]) {
+    unsigned char record[PACKED] = {0};
+    for (int i = 0; i < 81; i++) {
+        unsigned int cell = sudoku[i / 9][i % 9], digit = 0;
+        if (cell != 511) {
+            if (cell == 0 || (cell & (cell - 1))) { return false; }
+            for (digit = 1; cell >>= 1;) { digit++; }
+        }
+        record[i / 2] |= (unsigned char) (digit << (i % 2 * 4));
+    }
+    writer->checksum = checksum(writer->checksum, record);
+    writer->count++;
+    fwrite(record, 1, PACKED, writer->file);
+    return true;
+}
+
+bool corpus_finish(struct corpus_writer *writer) {
+    unsigned char header[HEADER];
+    memcpy(header, MAGIC, sizeof(MAGIC) - 1);
+    store_le(header + 8, writer->count);
+    store_le(header + 16, writer->checksum);
+    bool written = fseek(writer->file, 0, SEEK_SET) == 0 && fwrite(header, 1, HEADER, writer->file) == HEADER;
+    written &= !ferror(writer->file);
+    written &= fclose(writer->file) == 0;
+    if (!written) { perror(writer->path); }
+    free(writer);
+    return written;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file corpus.h
+ * @brief Bulk loading of sudokus from large inputs.
+ *
+ * A corpus holds sudokus as lines of 81 characters, '0' or '.' being an
+ * unknown digit, or as grids of 13 lines just as print() writes them,
+ * the two may be mixed. Empty lines are skipped. A regular file is
+ * mapped by mmap(), any other input is read through a window of 1 MiB.
+ * Cells are parsed by a table of character classes straight into digit
+ * bitsets.
+ *
+ * A packed corpus, written by corpus_create(), is read the same way. It
+ * starts with "SUDOKUP1", the count of sudokus and the FNV-1a checksum of
+ * the records, both 64-bit little endian. Records of 41 bytes follow, 4
+ * bits per cell in order, low bits first, 0 for an unknown digit. A
+ * mapped one is checked whole when opened and open to random access by
+ * corpus_get(), one read otherwise is checked at its end.
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct corpus;
+struct corpus_writer;
+
+/** result of corpus_next() */
+enum corpus_status {
+    corpus_loaded,
+    /** the record is skipped, the sudoku is undefined */
+    corpus_malformed,
+    corpus_end,
+    /** reading failed, the input ends here */
+    corpus_failed,
+};
+
+/**
+ * @brief Open the file, or STDIN if path is NULL.
+ *
+ * @return NULL if the file cannot be opened, is a damaged packed corpus
+ * or out of memory, reported on STDERR
+ */
+struct corpus *corpus_open(const char *path);
+
+/**
+ * @brief Release the corpus, STDIN stays open.
+ */
+void corpus_close(struct corpus *corpus);
+
+/**
+ * @brief Parse the next record.
+ *
+ * @param sudoku 2D array to store digit bitsets, unknown digits are 511
+ * @param line the line the record starts at, from 1, or its index from 1
+ * in a packed corpus
+ * @return corpus_loaded or corpus_malformed for a record, corpus_end or
+ * corpus_failed after the last one; a packed corpus that is not mapped
+ * fails at its end if the checksum does not match or more data follows,
+ * reported on STDERR
+ */
+enum corpus_status corpus_next(struct corpus *corpus, unsigned int sudoku[9][9], unsigned long *line);
+
+/**
+ * @brief Parse up to capacity sudokus into the array.
+ *
+ * Malformed records are reported on STDERR with their line numbers and
+ * skipped, so is a failed read.
+ *
+ * @return number of sudokus loaded, less than capacity at the end
+ */
+size_t corpus_load(struct corpus *corpus, unsigned int sudokus[][9][9], size_t capacity);
+
+/**
+ * @return number of sudokus of a mapped packed corpus, which corpus_get()
+ * reads, 0 for others
+ */
+size_t corpus_count(const struct corpus *corpus);
+
+/**
+ * @brief Unpack the sudoku at the index of a mapped packed corpus, safe
+ * to call from several threads.
+ *
+ * @return false if out of range, the corpus is not a mapped packed one or
+ * the record is malformed
+ */
+bool corpus_get(const struct corpus *corpus, size_t index, unsigned int sudoku[9][9]);
+
+/**
+ * @brief Create a packed corpus file.
+ *
+ * @return NULL if it cannot be created or out of memory, reported on
+ * STDERR
+ */
+struct corpus_writer *corpus_create(const char *path);
+
+/**
+ * @brief Append the sudoku, write errors are reported by corpus_finish().
+ *
+ * @param sudoku 2D array of clues and unknown digits (511)
+ * @return false if a cell is neither, nothing is written then
+ */
+bool corpus_write(struct corpus_writer *writer, unsigned int sudoku[9][9]);
+
+/**
+ * @brief Write the header and close the file, release the writer.
+ *
+ * @return false if writing failed, reported on STDERR
+ */
+bool corpus_finish(struct corpus_writer *writer);
+
+#endif //CORPUS_H
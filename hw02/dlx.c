@@ -0,0 +1,123 @@
+#include "dlx.h"
+#include "sudoku.h"
+#include <stdio.h>
+
+#define COLUMNS 324
+#define PLACEMENTS 729
+/* root, column headers and 4 nodes of every placement */
+#define NODES (1 + COLUMNS + PLACEMENTS * 4)
+#define ROOT 0
+
+/* links are node indices, headers are 1 to COLUMNS */
+struct dlx {
+    short left[NODES], right[NODES], up[NODES], down[NODES];
+    short column[NODES];
+    /* placement (cell * 9 + digit) of every node */
+    short placement[NODES];
+    short size[COLUMNS + 1];
+    short solution[81];
+    int nodes;
+};
+
+static void init_columns(struct dlx *dlx) {
+    for (int i = 0; i <= COLUMNS; i++) {
+        dlx->left[i] = (short) (i == 0 ? COLUMNS : i - 1);
+        dlx->right[i] = (short) (i == COLUMNS ? 0 : i + 1);
+        dlx->up[i] = dlx->down[i] = dlx->column[i] = (short) i;
+        dlx->size[i] = 0;
+    }
+    dlx->nodes = COLUMNS + 1;
+}
+
+static void add_placement(struct dlx *dlx, int row, int col, int digit) {
+    int columns[4] = {row * 9 + col,
+                      81 + row * 9 + digit,
+                      162 + col * 9 + digit,
+                      243 + (row / 3 * 3 + col / 3) * 9 + digit};
+    int first = dlx->nodes;
+    for (int i = 0; i < 4; i++) {
+        int node = dlx->nodes++, header = columns[i] + 1;
+        dlx->column[node] = (short) header;
+        dlx->placement[node] = (short) ((row * 9 + col) * 9 + digit);
+        dlx->up[node] = dlx->up[header];
+        dlx->down[node] = (short) header;
+        dlx->down[dlx->up[header]] = (short) node;
+        dlx->up[header] = (short) node;
+        dlx->size[header]++;
+        dlx->left[node] = (short) (i == 0 ? first + 3 : node - 1);
+        dlx->right[node] = (short) (i == 3 ? first : node + 1);
+    }
+}
+
+static void cover(struct dlx *dlx, int header) {
+    dlx->right[dlx->left[header]] = dlx->right[header];
+    dlx->left[dlx->right[header]] = dlx->left[header];
+    for (int i = dlx->down[header]; i != header; i = dlx->down[i]) {
+        for (int j = dlx->right[i]; j != i; j = dlx->right[j]) {
+            dlx->down[dlx->up[j]] = dlx->down[j];
+            dlx->up[dlx->down[j]] = dlx->up[j];
+            dlx->size[dlx->column[j]]--;
+        }
+    }
+}
+
+static void uncover(struct dlx *dlx, int header) {
+    for (int i = dlx->up[header]; i != header; i = dlx->up[i]) {
+        for (int j = dlx->left[i]; j != i; j = dlx->left[j]) {
+            dlx->size[dlx->column[j]]++;
+            dlx->down[dlx->up[j]] = (short) j;
+            dlx->up[dlx->down[j]] = (short) j;
+        }
+    }
+    dlx->right[dlx->left[header]] = (short) header;
+    dlx->left[dlx->right[header]] = (short) header;
+}
+
+static bool search(struct dlx *dlx, int depth) {
+    if (dlx->right[ROOT] == ROOT) { return true; }
+
+    /* the column with the fewest rows */
+    int best = dlx->right[ROOT];
+    for (int i = dlx->right[best]; i != ROOT && dlx->size[best] > 1; i = dlx->right[i]) {
+        if (dlx->size[i] < dlx->size[best]) { best = i; }
+    }
+    if (dlx->size[best] == 0) { return false; }
+
+    cover(dlx, best);
+    for (int i = dlx->down[best]; i != best; i = dlx->down[i]) {
+        dlx->solution[depth] = dlx->placement[i];
+        for (int j = dlx->right[i]; j != i; j = dlx->right[j]) { cover(dlx, dlx->column[j]); }
+        bool found = search(dlx, depth + 1);
+        for (int j = dlx->left[i]; j != i; j = dlx->left[j]) { uncover(dlx, dlx->column[j]); }
+        if (found) { return true; }
+    }
+    uncover(dlx, best);
+    return false;
+}
+
+bool dlx_search(unsigned int sudoku[9][9]) {
+    struct dlx dlx;
+    init_columns(&dlx);
+    for (int row = 0; row < 9; row++) {
+        for (int col = 0; col < 9; col++) {
+            for (int digit = 0; digit < 9; digit++) {
+                if (sudoku[row][col] & (1u << digit)) { add_placement(&dlx, row, col, digit); }
+            }
+        }
+    }
+    if (!search(&dlx, 0)) { return false; }
+
+    for (int i = 0; i < 81; i++) {
+        int cell = dlx.solution[i] / 9;
+        sudoku[cell / 9][cell % 9] = 1u << (dlx.solution[i] % 9);
+    }
+    return true;
+}
+
+bool dlx_solve(unsigned int sudoku[9][9]) {
+    if (!is_valid(sudoku)) {
+        fprintf(stderr, "Invalid sudoku\n");
+        return false;
+    }
+    return dlx_search(sudoku);
+}
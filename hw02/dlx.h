@@ -0,0 +1,38 @@
+/**
+ * @file dlx.h
+ * @brief Exact cover (Dancing Links) solver of sudoku.
+ *
+ * The sudoku is the exact cover problem of 324 constraints (every cell,
+ * every digit in every row, column and box once) by 729 placements
+ * (digit in cell). Only placements allowed by the cell bitsets become
+ * rows of the matrix, so eliminated candidates are respected.
+ * All nodes live in one flat array, nothing is allocated.
+ */
+
+#ifndef DLX_H
+#define DLX_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Solve the sudoku by Algorithm X, reports nothing.
+ *
+ * Reentrant, the matrix lives on the stack of the caller.
+ *
+ * @param sudoku 2D array of digit bitsets, all cells are unique on success
+ * @return true if solved, false if invalid or there is no solution
+ */
+bool dlx_search(unsigned int sudoku[9][9]);
+
+/**
+ * @brief Solve the sudoku by Algorithm X.
+ *
+ * @note In case the sudoku is invalid, reports to user with one
+ * line message on STDERR and returns false.
+ *
+ * @param sudoku 2D array of digit bitsets, all cells are unique on success
+ * @return true if solved, false if there is no solution
+ */
+bool dlx_solve(unsigned int sudoku[9][9]);
+
+#endif //DLX_H
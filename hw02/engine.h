@@ -0,0 +1,66 @@
+/**
+ * @file engine.h
+ * @brief Backtracking search of sudokus of any box size.
+ *
+ * The search of sudoku.c is written once in engine_impl.h for the box size
+ * and the cell type given at compile time, every instance (9x9, 16x16 and
+ * 25x25) is described by a struct engine. A sudoku is then a 2D array of
+ * side * side cells of the narrowest type holding side digit bits, passed
+ * as void *.
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** cells of the largest sudoku */
+#define ENGINE_MAX_CELLS 625
+
+/** one instance of the search */
+struct engine {
+    /** 3, 4 or 5, the side is box * box */
+    int box, side;
+    /** bytes of a sudoku */
+    size_t size;
+
+    /**
+     * @brief Load a sudoku of side * side characters, digits are 1-9 and
+     * then letters from A, 0 and . are unknown cells.
+     *
+     * @return false if the line is malformed
+     */
+    bool (*parse)(void *sudoku, const char *line, size_t length);
+    /**
+     * @brief Store side * side characters of the sudoku, 0 for cells that
+     * are not unique. Not terminated.
+     */
+    void (*format)(const void *sudoku, char *line);
+
+    /** @brief Candidates of the cell (row * side + col) as digit bits. */
+    unsigned int (*candidates)(const void *sudoku, int index);
+    /** @brief Set the cell (row * side + col) to the digit bitset. */
+    void (*place)(void *sudoku, int index, unsigned int digits);
+
+    /** @brief See branch_cell(), side * side for a complete sudoku. */
+    int (*branch_cell)(void *sudoku);
+    /** @brief See count_solutions_until(). */
+    int (*count_solutions_until)(void *sudoku, int limit, const volatile int *stop);
+};
+
+/** unsigned int cells, the sudokus of sudoku.h */
+extern const struct engine engine9;
+/** uint16_t cells */
+extern const struct engine engine16;
+/** uint32_t cells */
+extern const struct engine engine25;
+
+/**
+ * @brief Strategies of the search chosen by select_strategies(), shared
+ * by all instances.
+ */
+unsigned int engine_search_strategies(void);
+
+#endif //ENGINE_H
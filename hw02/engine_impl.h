@@ -0,0 +1,459 @@
+/*
+ * Backtracking search for sudokus of box size BOX with cells of type CELL,
+ * included once by the translation unit of every instance after both are
+ * defined. Defines the static functions of the search and the struct
+ * engine ENGINE describing it.
+ *
+ * All sizes are constants, so loops over units have constant bounds that
+ * the compiler unrolls, and the 9x9 instance compiles to the same code as
+ * a search written for it.
+ */
+
+#include "engine.h"
+
+#include <string.h>
+
+#if !defined(BOX) || !defined(CELL) || !defined(ENGINE)
+#error "BOX, CELL and ENGINE must be defined before engine_impl.h is included"
+#endif
+
+#define SIDE (BOX * BOX)
+#define CELLS (SIDE * SIDE)
+#define ALL_DIGITS ((1u << SIDE) - 1)
+#define BOX_OF(row, col) ((row) / BOX * BOX + (col) / BOX)
+
+#if defined(__GNUC__)
+#define UNROLLED _Pragma("GCC unroll 25")
+#else
+#define UNROLLED
+#endif
+
+/* the flag is set by another thread */
+#if defined(__GNUC__)
+#define STOP_REQUESTED(stop) __atomic_load_n((stop), __ATOMIC_RELAXED)
+#else
+#define STOP_REQUESTED(stop) (*(stop))
+#endif
+
+/* every change removes a digit from a cell or adds one to a mask */
+#define TRAIL_SIZE (CELLS * SIDE + 3 * CELLS)
+
+static int bitset_count(unsigned int original) {
+#if defined(__GNUC__)
+    return __builtin_popcount(original);
+#else
+    int count = 0;
+    for (; original; original &= original - 1) { count++; }
+    return count;
+#endif
+}
+
+static bool bitset_is_unique(unsigned int original) {
+    return !(original & (original - 1));
+}
+
+/* solver state, the used masks hold the digits of unique cells of every unit */
+struct grid {
+    CELL (*cells)[SIDE];
+    CELL row_used[SIDE], col_used[SIDE], box_used[SIDE];
+    /* unique cells whose digit is yet to be removed from their peers */
+    int queue[CELLS];
+    int head, tail;
+    /* previous values of changed cells and masks, to undo a guess */
+    struct {
+        CELL *slot;
+        CELL value;
+    } trail[TRAIL_SIZE];
+    int trail_size;
+    /* strategies run by propagate() once no naked single is left */
+    unsigned int strategies;
+    /* set by strategies when they remove a candidate */
+    bool progress;
+    /* order of guesses, lowest digit first if NULL */
+    uint64_t *random;
+    /* the search gives up once it is set, if not NULL */
+    const volatile int *stop;
+};
+
+static void update(struct grid *grid, CELL *slot, unsigned int value) {
+    grid->trail[grid->trail_size].slot = slot;
+    grid->trail[grid->trail_size].value = *slot;
+    grid->trail_size++;
+    *slot = (CELL) value;
+}
+
+static void undo(struct grid *grid, int trail_size) {
+    while (grid->trail_size > trail_size) {
+        grid->trail_size--;
+        *grid->trail[grid->trail_size].slot = grid->trail[grid->trail_size].value;
+    }
+    grid->head = grid->tail = 0;
+}
+
+/* records the unique cell in the masks of its units, false on a conflict */
+static bool assign(struct grid *grid, int row, int col) {
+    unsigned int digit = grid->cells[row][col];
+    int box = BOX_OF(row, col);
+    if ((grid->row_used[row] | grid->col_used[col] | grid->box_used[box]) & digit) { return false; }
+    update(grid, &grid->row_used[row], grid->row_used[row] | digit);
+    update(grid, &grid->col_used[col], grid->col_used[col] | digit);
+    update(grid, &grid->box_used[box], grid->box_used[box] | digit);
+    grid->queue[grid->tail++] = row * SIDE + col;
+    return true;
+}
+
+static bool drop_from_peer(struct grid *grid, int row, int col, unsigned int digit) {
+    CELL *cell = &grid->cells[row][col];
+    if (bitset_is_unique(*cell) || !(*cell & digit)) { return true; }
+    update(grid, cell, *cell & ~digit);
+    return !bitset_is_unique(*cell) || assign(grid, row, col);
+}
+
+/* removes the digit of the cell from its peers, false on a conflict */
+static bool eliminate_peers(struct grid *grid, int index) {
+    int row = index / SIDE, col = index % SIDE;
+    int box_row = row - row % BOX, box_col = col - col % BOX;
+    unsigned int digit = grid->cells[row][col];
+    UNROLLED
+    for (int i = 0; i < SIDE; i++) {
+        if (i != col && !drop_from_peer(grid, row, i, digit)) { return false; }
+        if (i != row && !drop_from_peer(grid, i, col, digit)) { return false; }
+        int peer_row = box_row + i / BOX, peer_col = box_col + i % BOX;
+        if (peer_row != row && peer_col != col && !drop_from_peer(grid, peer_row, peer_col, digit)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* fills the masks from the unique cells and strips them from the other cells */
+static bool grid_init(struct grid *grid, CELL sudoku[SIDE][SIDE], unsigned int strategies) {
+    memset(grid->row_used, 0, sizeof(grid->row_used));
+    memset(grid->col_used, 0, sizeof(grid->col_used));
+    memset(grid->box_used, 0, sizeof(grid->box_used));
+    grid->head = grid->tail = grid->trail_size = 0;
+    grid->cells = sudoku;
+    grid->strategies = strategies;
+    grid->random = NULL;
+    grid->stop = NULL;
+    for (int i = 0; i < CELLS; i++) {
+        unsigned int cell = sudoku[i / SIDE][i % SIDE];
+        if (cell == 0 || (bitset_is_unique(cell) && !assign(grid, i / SIDE, i % SIDE))) { return false; }
+    }
+    grid->head = grid->tail;
+    for (int i = 0; i < CELLS; i++) {
+        int row = i / SIDE, col = i % SIDE;
+        CELL *cell = &sudoku[row][col];
+        unsigned int used = grid->row_used[row] | grid->col_used[col] | grid->box_used[BOX_OF(row, col)];
+        if (bitset_is_unique(*cell) || !(*cell & used)) { continue; }
+        update(grid, cell, *cell & ~used);
+        if (*cell == 0 || (bitset_is_unique(*cell) && !assign(grid, row, col))) { return false; }
+    }
+    return true;
+}
+
+/* rows are units 0 to SIDE - 1, then columns and boxes */
+static void unit_cell(int unit, int k, int *row, int *col) {
+    if (unit < SIDE) {
+        *row = unit;
+        *col = k;
+    } else if (unit < 2 * SIDE) {
+        *row = k;
+        *col = unit - SIDE;
+    } else {
+        *row = (unit - 2 * SIDE) / BOX * BOX + k / BOX;
+        *col = (unit - 2 * SIDE) % BOX * BOX + k % BOX;
+    }
+}
+
+/* digits of unique cells of the unit, including those not yet removed from peers */
+static unsigned int unit_used(const struct grid *grid, int unit) {
+    if (unit < SIDE) { return grid->row_used[unit]; }
+    if (unit < 2 * SIDE) { return grid->col_used[unit - SIDE]; }
+    return grid->box_used[unit - 2 * SIDE];
+}
+
+static bool in_unit(int unit, int row, int col) {
+    if (unit < SIDE) { return row == unit; }
+    if (unit < 2 * SIDE) { return col == unit - SIDE; }
+    return BOX_OF(row, col) == unit - 2 * SIDE;
+}
+
+/* keeps only allowed candidates of the unknown cell, false on a conflict */
+static bool restrict_cell(struct grid *grid, int row, int col, unsigned int allowed) {
+    CELL *cell = &grid->cells[row][col];
+    if (bitset_is_unique(*cell) || !(*cell & ~allowed)) { return true; }
+    if (!(*cell & allowed)) { return false; }
+    update(grid, cell, *cell & allowed);
+    grid->progress = true;
+    return !bitset_is_unique(*cell) || assign(grid, row, col);
+}
+
+/* a digit possible in one cell of a unit only goes there */
+static bool hidden_singles(struct grid *grid) {
+    for (int unit = 0; unit < 3 * SIDE; unit++) {
+        unsigned int placed = unit_used(grid, unit), once = 0, twice = 0;
+        for (int k = 0; k < SIDE; k++) {
+            int row, col;
+            unit_cell(unit, k, &row, &col);
+            unsigned int cell = grid->cells[row][col];
+            if (!bitset_is_unique(cell)) {
+                twice |= once & cell;
+                once |= cell;
+            }
+        }
+        if ((placed | once) != ALL_DIGITS) { return false; }
+        unsigned int hidden = once & ~twice & ~placed;
+        for (int k = 0; hidden && k < SIDE; k++) {
+            int row, col;
+            unit_cell(unit, k, &row, &col);
+            unsigned int only = grid->cells[row][col] & hidden;
+            if (!only || bitset_is_unique(grid->cells[row][col])) { continue; }
+            if (!bitset_is_unique(only) || !restrict_cell(grid, row, col, only)) { return false; }
+        }
+    }
+    return true;
+}
+
+/* two cells of a unit with the same two candidates take them from the other cells */
+static bool naked_pairs(struct grid *grid) {
+    for (int unit = 0; unit < 3 * SIDE; unit++) {
+        for (int k = 0; k < SIDE; k++) {
+            int row, col;
+            unit_cell(unit, k, &row, &col);
+            unsigned int pair = grid->cells[row][col];
+            if (bitset_count(pair) != 2) { continue; }
+            for (int j = k + 1; j < SIDE; j++) {
+                int pair_row, pair_col;
+                unit_cell(unit, j, &pair_row, &pair_col);
+                if (grid->cells[pair_row][pair_col] != pair) { continue; }
+                for (int m = 0; m < SIDE; m++) {
+                    int other_row, other_col;
+                    unit_cell(unit, m, &other_row, &other_col);
+                    if (m != k && m != j && !restrict_cell(grid, other_row, other_col, ~pair)) { return false; }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* two digits possible in the same two cells of a unit only leave those cells no other candidate */
+static bool hidden_pairs(struct grid *grid) {
+    for (int unit = 0; unit < 3 * SIDE; unit++) {
+        /* cells of the unit (bit k) where the digit is a candidate */
+        unsigned int positions[SIDE] = {0};
+        for (int k = 0; k < SIDE; k++) {
+            int row, col;
+            unit_cell(unit, k, &row, &col);
+            unsigned int cell = grid->cells[row][col];
+            for (int digit = 0; !bitset_is_unique(cell) && digit < SIDE; digit++) {
+                if (cell & (1u << digit)) { positions[digit] |= 1u << k; }
+            }
+        }
+        unsigned int placed = unit_used(grid, unit);
+        for (int first = 0; first < SIDE; first++) {
+            if (bitset_count(positions[first]) != 2 || (placed & (1u << first))) { continue; }
+            for (int second = first + 1; second < SIDE; second++) {
+                if (positions[second] != positions[first] || (placed & (1u << second))) { continue; }
+                for (int k = 0; k < SIDE; k++) {
+                    int row, col;
+                    unit_cell(unit, k, &row, &col);
+                    if ((positions[first] & (1u << k))
+                        && !restrict_cell(grid, row, col, (1u << first) | (1u << second))) { return false; }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Pointing and claiming: a digit whose candidates in a box lie in one row
+ * or column, or whose candidates in a row or column lie in one box, is
+ * removed from the rest of the other unit.
+ */
+static bool box_line(struct grid *grid) {
+    for (int unit = 0; unit < 3 * SIDE; unit++) {
+        unsigned int placed = unit_used(grid, unit);
+        for (unsigned int digit = 1; digit <= ALL_DIGITS; digit <<= 1) {
+            if (placed & digit) { continue; }
+            int count = 0, first_row = 0, first_col = 0;
+            bool same_row = true, same_col = true, same_box = true;
+            for (int k = 0; k < SIDE; k++) {
+                int row, col;
+                unit_cell(unit, k, &row, &col);
+                unsigned int cell = grid->cells[row][col];
+                if (bitset_is_unique(cell) || !(cell & digit)) { continue; }
+                if (count++ == 0) {
+                    first_row = row;
+                    first_col = col;
+                }
+                same_row &= row == first_row;
+                same_col &= col == first_col;
+                same_box &= BOX_OF(row, col) == BOX_OF(first_row, first_col);
+            }
+            if (count < 2) { continue; }
+
+            int target;
+            if (unit >= 2 * SIDE && same_row) {
+                target = first_row;
+            } else if (unit >= 2 * SIDE && same_col) {
+                target = SIDE + first_col;
+            } else if (unit < 2 * SIDE && same_box) {
+                target = 2 * SIDE + BOX_OF(first_row, first_col);
+            } else {
+                continue;
+            }
+            for (int k = 0; k < SIDE; k++) {
+                int row, col;
+                unit_cell(target, k, &row, &col);
+                if (!in_unit(unit, row, col) && !restrict_cell(grid, row, col, ~digit)) { return false; }
+            }
+        }
+    }
+    return true;
+}
+
+/* in the order of the strategy bits, cheapest first */
+static bool (*const STRATEGIES[])(struct grid *grid) = {hidden_singles, naked_pairs, hidden_pairs, box_line};
+
+/*
+ * Removes digits of unique cells from their peers; once none is queued,
+ * runs the selected strategies and starts over whenever one of them
+ * makes progress. False on a conflict.
+ */
+static bool propagate(struct grid *grid) {
+    for (;;) {
+        while (grid->head < grid->tail) {
+            if (!eliminate_peers(grid, grid->queue[grid->head++])) { return false; }
+        }
+        grid->head = grid->tail = 0;
+        grid->progress = false;
+        for (size_t i = 0; !grid->progress && i < sizeof(STRATEGIES) / sizeof(STRATEGIES[0]); i++) {
+            if ((grid->strategies & (1u << i)) && !STRATEGIES[i](grid)) { return false; }
+        }
+        if (!grid->progress) { return true; }
+    }
+}
+
+/* splitmix64, every generated sudoku has its own stream */
+static uint64_t random_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15u);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    return z ^ (z >> 31);
+}
+
+static unsigned int random_below(uint64_t *state, unsigned int bound) {
+    return (unsigned int) (random_next(state) % bound);
+}
+
+/* one of the digits of the bitset */
+static unsigned int random_digit(uint64_t *state, unsigned int digits) {
+    for (unsigned int skip = random_below(state, (unsigned int) bitset_count(digits)); skip > 0; skip--) {
+        digits &= digits - 1;
+    }
+    return digits & -digits;
+}
+
+/* index of an unknown cell with fewest candidates, CELLS if there is none */
+static int best_cell(CELL (*cells)[SIDE]) {
+    int best = CELLS, best_count = SIDE + 1;
+    for (int i = 0; i < CELLS && best_count > 2; i++) {
+        int count = bitset_count(cells[i / SIDE][i % SIDE]);
+        if (count > 1 && count < best_count) {
+            best = i;
+            best_count = count;
+        }
+    }
+    return best;
+}
+
+/*
+ * Tries the candidates of the cell with fewest of them, counting complete
+ * grids in found. True once limit of them are found, the grid then holds
+ * the last one, or once stopped; otherwise every change is undone.
+ */
+static bool search(struct grid *grid, int limit, int *found) {
+    if (grid->stop && STOP_REQUESTED(grid->stop)) { return true; }
+    int best = best_cell(grid->cells);
+    if (best == CELLS) { return ++*found >= limit; }
+
+    int row = best / SIDE, col = best % SIDE, trail_size = grid->trail_size;
+    unsigned int candidates = grid->cells[row][col];
+    while (candidates) {
+        unsigned int digit = grid->random ? random_digit(grid->random, candidates) : candidates & -candidates;
+        candidates &= ~digit;
+        update(grid, &grid->cells[row][col], digit);
+        if (assign(grid, row, col) && propagate(grid) && search(grid, limit, found)) { return true; }
+        undo(grid, trail_size);
+    }
+    return false;
+}
+
+static int engine_count_solutions_until(void *sudoku, int limit, const volatile int *stop) {
+    struct grid grid;
+    int found = 0;
+    if (limit > 0 && grid_init(&grid, sudoku, engine_search_strategies()) && propagate(&grid)) {
+        grid.stop = stop;
+        search(&grid, limit, &found);
+    }
+    return found;
+}
+
+static int engine_branch_cell(void *sudoku) {
+    struct grid grid;
+    if (!grid_init(&grid, sudoku, engine_search_strategies()) || !propagate(&grid)) { return -1; }
+    return best_cell(grid.cells);
+}
+
+/* digits above 9 are letters */
+static const char ENGINE_DIGITS[] = "123456789ABCDEFGHIJKLMNOP";
+
+static bool engine_parse(void *sudoku, const char *line, size_t length) {
+    CELL (*cells)[SIDE] = sudoku;
+    if (length != CELLS) { return false; }
+    for (int i = 0; i < CELLS; i++) {
+        const char *digit = line[i] != '\0' ? memchr(ENGINE_DIGITS, line[i], SIDE) : NULL;
+        if (digit) {
+            cells[i / SIDE][i % SIDE] = (CELL) (1u << (digit - ENGINE_DIGITS));
+        } else if (line[i] == '0' || line[i] == '.') {
+            cells[i / SIDE][i % SIDE] = ALL_DIGITS;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void engine_format(const void *sudoku, char *line) {
+    /* rows follow each other, a pointer to const rows is not convertible in C99 */
+    const CELL *cells = sudoku;
+    for (int i = 0; i < CELLS; i++) {
+        unsigned int cell = cells[i];
+        line[i] = cell != 0 && bitset_is_unique(cell) ? ENGINE_DIGITS[bitset_count(cell - 1)] : '0';
+    }
+}
+
+static unsigned int engine_candidates(const void *sudoku, int index) {
+    const CELL *cells = sudoku;
+    return cells[index];
+}
+
+static void engine_place(void *sudoku, int index, unsigned int digits) {
+    CELL (*cells)[SIDE] = sudoku;
+    cells[index / SIDE][index % SIDE] = (CELL) digits;
+}
+
+const struct engine ENGINE = {
+    .box = BOX,
+    .side = SIDE,
+    .size = sizeof(CELL[SIDE][SIDE]),
+    .parse = engine_parse,
+    .format = engine_format,
+    .candidates = engine_candidates,
+    .place = engine_place,
+    .branch_cell = engine_branch_cell,
+    .count_solutions_until = engine_count_solutions_until,
+};
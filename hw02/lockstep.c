@@ -0,0 +1,141 @@
+#include "lockstep.h"
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+#ifdef HAVE_X86_KERNELS
+
+/* cells of the 9 rows, 9 columns and 9 boxes */
+static const unsigned char UNITS[27][9] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8}, {9, 10, 11, 12, 13, 14, 15, 16, 17},
+        {18, 19, 20, 21, 22, 23, 24, 25, 26}, {27, 28, 29, 30, 31, 32, 33, 34, 35},
+        {36, 37, 38, 39, 40, 41, 42, 43, 44}, {45, 46, 47, 48, 49, 50, 51, 52, 53},
+        {54, 55, 56, 57, 58, 59, 60, 61, 62}, {63, 64, 65, 66, 67, 68, 69, 70, 71},
+        {72, 73, 74, 75, 76, 77, 78, 79, 80},
+        {0, 9, 18, 27, 36, 45, 54, 63, 72}, {1, 10, 19, 28, 37, 46, 55, 64, 73},
+        {2, 11, 20, 29, 38, 47, 56, 65, 74}, {3, 12, 21, 30, 39, 48, 57, 66, 75},
+        {4, 13, 22, 31, 40, 49, 58, 67, 76}, {5, 14, 23, 32, 41, 50, 59, 68, 77},
+        {6, 15, 24, 33, 42, 51, 60, 69, 78}, {7, 16, 25, 34, 43, 52, 61, 70, 79},
+        {8, 17, 26, 35, 44, 53, 62, 71, 80},
+        {0, 1, 2, 9, 10, 11, 18, 19, 20}, {3, 4, 5, 12, 13, 14, 21, 22, 23},
+        {6, 7, 8, 15, 16, 17, 24, 25, 26}, {27, 28, 29, 36, 37, 38, 45, 46, 47},
+        {30, 31, 32, 39, 40, 41, 48, 49, 50}, {33, 34, 35, 42, 43, 44, 51, 52, 53},
+        {54, 55, 56, 63, 64, 65, 72, 73, 74}, {57, 58, 59, 66, 67, 68, 75, 76, 77},
+        {60, 61, 62, 69, 70, 71, 78, 79, 80},
+};
+
+
+bool lockstep_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+/* all-ones in lanes holding a single digit or none */
+__attribute__((target("avx2")))
+static inline __m256i single_lanes(__m256i cell) {
+    __m256i lower = _mm256_sub_epi16(cell, _mm256_set1_epi16(1));
+    return _mm256_cmpeq_epi16(_mm256_and_si256(cell, lower), _mm256_setzero_si256());
+}
+
+/*
+ * One pass over all units: digits of singles are removed from the other
+ * cells of the unit, a digit possible in one cell only is placed there.
+ * Lanes with two equal singles, an empty cell or a missing digit become
+ * invalid and are not touched any more. Returns the lanes that changed.
+ */
+__attribute__((target("avx2")))
+static __m256i propagate_units(__m256i cells[81], __m256i *invalid) {
+    const __m256i zero = _mm256_setzero_si256(), all_digits = _mm256_set1_epi16(511);
+    __m256i changed = zero;
+    for (int unit = 0; unit < 27; unit++) {
+        __m256i placed = zero, placed_twice = zero, possible = zero, possible_twice = zero, empty = zero;
+        for (int k = 0; k < 9; k++) {
+            __m256i cell = cells[UNITS[unit][k]];
+            __m256i single = _mm256_and_si256(single_lanes(cell), cell);
+            placed_twice = _mm256_or_si256(placed_twice, _mm256_and_si256(placed, single));
+            placed = _mm256_or_si256(placed, single);
+            possible_twice = _mm256_or_si256(possible_twice, _mm256_and_si256(possible, cell));
+            possible = _mm256_or_si256(possible, cell);
+            empty = _mm256_or_si256(empty, _mm256_cmpeq_epi16(cell, zero));
+        }
+        *invalid = _mm256_or_si256(*invalid, empty);
+        *invalid = _mm256_or_si256(*invalid, _mm256_xor_si256(_mm256_cmpeq_epi16(placed_twice, zero),
+                                                              _mm256_set1_epi16(-1)));
+        *invalid = _mm256_or_si256(*invalid, _mm256_xor_si256(_mm256_cmpeq_epi16(possible, all_digits),
+                                                              _mm256_set1_epi16(-1)));
+        __m256i hidden = _mm256_andnot_si256(_mm256_or_si256(possible_twice, placed), possible);
+
+        for (int k = 0; k < 9; k++) {
+            __m256i *cell = &cells[UNITS[unit][k]];
+            __m256i single = single_lanes(*cell);
+            __m256i reduced = _mm256_andnot_si256(placed, *cell);
+            __m256i only_here = _mm256_and_si256(reduced, hidden);
+            reduced = _mm256_blendv_epi8(reduced, only_here,
+                                         _mm256_xor_si256(_mm256_cmpeq_epi16(only_here, zero),
+                                                          _mm256_set1_epi16(-1)));
+            __m256i change = _mm256_andnot_si256(_mm256_or_si256(single, *invalid),
+                                                 _mm256_xor_si256(reduced, *cell));
+            *cell = _mm256_xor_si256(*cell, change);
+            changed = _mm256_or_si256(changed, change);
+        }
+    }
+    return changed;
+}
+
+__attribute__((target("avx2")))
+static void propagate_avx2(unsigned int (*const sudokus[])[9], size_t count, enum lockstep_result *results) {
+    uint16_t lanes[81][LOCKSTEP_LANES] __attribute__((aligned(32)));
+    __m256i cells[81];
+    for (int i = 0; i < 81; i++) {
+        for (size_t lane = 0; lane < LOCKSTEP_LANES; lane++) {
+            /* unused lanes hold empty cells, they are invalid right away */
+            lanes[i][lane] = (uint16_t) (lane < count ? sudokus[lane][i / 9][i % 9] : 0);
+        }
+        cells[i] = _mm256_load_si256((const __m256i *) lanes[i]);
+    }
+
+    __m256i invalid = _mm256_setzero_si256(), changed;
+    do {
+        changed = propagate_units(cells, &invalid);
+    } while (!_mm256_testz_si256(changed, changed));
+
+    __m256i open = _mm256_setzero_si256();
+    for (int i = 0; i < 81; i++) {
+        open = _mm256_or_si256(open, _mm256_xor_si256(single_lanes(cells[i]), _mm256_set1_epi16(-1)));
+        _mm256_store_si256((__m256i *) lanes[i], cells[i]);
+    }
+    uint16_t invalid_lanes[LOCKSTEP_LANES] __attribute__((aligned(32)));
+    uint16_t open_lanes[LOCKSTEP_LANES] __attribute__((aligned(32)));
+    _mm256_store_si256((__m256i *) invalid_lanes, invalid);
+    _mm256_store_si256((__m256i *) open_lanes, open);
+
+    for (size_t lane = 0; lane < count; lane++) {
+        for (int i = 0; i < 81; i++) {
+            sudokus[lane][i / 9][i % 9] = lanes[i][lane];
+        }
+        results[lane] = invalid_lanes[lane] ? lockstep_invalid : open_lanes[lane] ? lockstep_open : lockstep_solved;
+    }
+}
+
+void lockstep_propagate(unsigned int (*const sudokus[])[9], size_t count, enum lockstep_result *results) {
+    propagate_avx2(sudokus, count, results);
+}
+
+#else
+
+bool lockstep_supported(void) {
+    return false;
+}
+
+void lockstep_propagate(unsigned int (*const sudokus[])[9], size_t count, enum lockstep_result *results) {
+    for (size_t i = 0; i < count; i++) {
+        (void) sudokus;
+        results[i] = lockstep_open;
+    }
+}
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * @file lockstep.h
+ * @brief Elimination of up to 16 sudokus at once in SIMD lanes.
+ *
+ * Every cell of 16 sudokus is one AVX2 vector of 16-bit lanes. Naked and
+ * hidden singles are propagated in all lanes together until none of them
+ * changes, lanes found invalid are masked out. Sudokus that still have
+ * unknown cells are left for a search.
+ */
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOCKSTEP_LANES 16
+
+enum lockstep_result { lockstep_solved, lockstep_invalid, lockstep_open };
+
+/**
+ * @brief Check that the CPU runs the lockstep kernel (AVX2).
+ */
+bool lockstep_supported(void);
+
+/**
+ * @brief Propagate singles in count sudokus at once.
+ *
+ * Must not be called unless lockstep_supported().
+ *
+ * @param sudokus up to LOCKSTEP_LANES 2D arrays of digit bitsets,
+ * reduced in place
+ * @param results solved, invalid, or open if a search has to finish it
+ */
+void lockstep_propagate(unsigned int (*const sudokus[])[9], size_t count, enum lockstep_result *results);
+
+#endif //LOCKSTEP_H
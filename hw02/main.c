@@ -2,6 +2,11 @@
  * Placing interface header here checks for header selfsufficiency
  */
 #include "sudoku.h"
+#include "dlx.h"
+#include "batch.h"
+#include "parallel.h"
+#include "engine.h"
+#include "cache.h"
 
 /*
  * General standard headers
@@ -10,6 +15,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /*
  * Pseudorandom support (bonus)
@@ -52,6 +58,9 @@
 static const int SILENCE_NO_REPORT = 1;
 static const int SILENCE_NO_RESULT = 2;
 
+// threads of one search, more than 1 with --solver=parallel
+static int search_threads = 1;
+
 
 /**
  * This function should provide number stored in the corresponding cell of the
@@ -108,15 +117,43 @@ static void usage(const char *program)
             "\t--cell\t\tPrint sudoku cell set value in binary\n"
             "\n"
             "\t--solve\t\t\"Solve\" sudoku using elimination only (no backtracking)\n"
+            "\t--strategies LIST\tElimination besides naked singles, comma separated:\n"
+            "\t\t\thidden-singles, naked-pairs, hidden-pairs, box-line,\n"
+            "\t\t\tall (default) or none\n"
+#if defined(BONUS_GENERIC_SOLVE)
+            "\t--search-strategies LIST\tThe same for every step of\n"
+            "\t\t\t--generic-solve and --batch (default: hidden-singles)\n"
+#endif
 #if defined(BONUS_GENERIC_SOLVE)
             "\t--generic-solve\tGeneric solver of any sudoku\n"
+            "\t--solver=NAME\tSolver used by --generic-solve and --batch:\n"
+            "\t\t\tbacktrack (default), dlx (exact cover) or parallel\n"
+            "\t\t\t(backtracking on --threads, also for --count-solutions)\n"
+            "\t--batch [FILE]\tSolve sudokus of 81 characters per line, grids as\n"
+            "\t\t\t--print writes them or a packed corpus from FILE or STDIN,\n"
+            "\t\t\tprint solutions in order, one per line (no sudoku loaded)\n"
+            "\t--pack FILE\tWrite sudokus of --batch to FILE as a packed corpus\n"
+            "\t\t\t(4 bits per cell) instead of solving them\n"
+            "\t--no-lockstep\tDo not eliminate 16 sudokus at once with AVX2 in --batch\n"
+            "\t--cache [FILE]\tAnswer sudokus equivalent to solved ones (by symmetry)\n"
+            "\t\t\tfrom a cache mapped from FILE, or in memory for this run,\n"
+            "\t\t\tin --generic-solve and --batch (9x9 only)\n"
+            "\t--size B\tBox size of --batch sudokus: 3 (default), 4 or 5, lines\n"
+            "\t\t\tof B^4 digits 1-9 and letters from A, 0 or . unknown\n"
 #endif
 #if defined(BONUS_GENERATE)
             "\t--generate\tGenerate sudoku - remove digits as long as \"solvable\"\n"
             "\t--seed SEED\tInitialize pseudorandom number generator (deterministic rand)\n"
+            "\t--generate-batch N\tGenerate N sudokus with unique solution, one per\n"
+            "\t\t\tline (no sudoku loaded, reproducible by --seed)\n"
+            "\t--clues K\tLeave at most K digits in generated sudokus\n"
+            "\t--difficulty D\tGenerate easy, medium, hard or expert sudokus only\n"
 #endif
+            "\t--threads N\tNumber of worker threads (default: all CPUs)\n"
             "\n"
             "\t--check-valid\tCheck if the sudoku is (currently) valid\n"
+            "\t--count-solutions [K]\tCount solutions up to K (default 2,\n"
+            "\t\t\twhich checks that the solution is unique)\n"
             "\t--needs-solving\tCheck if the valid sudoku is solved\n"
             "\n"
             "\t--eliminate-row ROW\tEliminate the row\n"
@@ -218,6 +255,264 @@ static void print_cell_value(unsigned int sudoku[9][9], const char *optarg, int
     print_binary(sudoku[row][col]);
 }
 
+static int parse_threads(const char *optarg)
+{
+    char *endptr = NULL;
+    long threads = strtol(optarg, &endptr, 10);
+
+    if (*endptr != '\0' || endptr == optarg || threads < 1 || threads > 1024) {
+        fprintf(stderr, "Invalid number of threads %s\n", optarg);
+        return 0;
+    }
+    return (int) threads;
+}
+
+// all online CPUs unless chosen by --threads
+static int worker_threads(int threads)
+{
+    if (threads > 0)
+        return threads;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int) cpus : 1;
+}
+
+#if defined(BONUS_GENERIC_SOLVE)
+struct solver
+{
+    const char *name;
+    // reports invalid sudoku, for --generic-solve
+    sudoku_solver solve;
+    // silent and reentrant, for --batch
+    sudoku_solver batch_solve;
+};
+
+static bool parallel_generic_solve(unsigned int sudoku[9][9])
+{
+    if (!is_valid(sudoku)) {
+        fprintf(stderr, "Invalid sudoku\n");
+        return false;
+    }
+    return parallel_solve(sudoku, search_threads);
+}
+
+static const struct solver solvers[] = {
+    { "backtrack", generic_solve, backtrack_solve },
+    { "dlx", dlx_solve, dlx_search },
+    // --batch is parallel already, one sudoku per thread
+    { "parallel", parallel_generic_solve, backtrack_solve },
+};
+
+static const struct solver *find_solver(const char *name)
+{
+    for (size_t i = 0; i < sizeof(solvers) / sizeof(solvers[0]); ++i) {
+        if (strcmp(name, solvers[i].name) == 0)
+            return &solvers[i];
+    }
+
+    fprintf(stderr, "Unknown solver %s\n", name);
+    return NULL;
+}
+
+static int pack_demo(const char *path, const char *pack_path)
+{
+    struct corpus *in = corpus_open(path);
+    if (in == NULL)
+        return EXIT_FAILURE;
+    struct corpus_writer *out = corpus_create(pack_path);
+    if (out == NULL) {
+        corpus_close(in);
+        return EXIT_FAILURE;
+    }
+
+    // malformed records are left out, the packed corpus holds the others in order
+    unsigned int sudoku[9][9];
+    unsigned long line;
+    enum corpus_status status;
+    bool all_packed = true;
+    while ((status = corpus_next(in, sudoku, &line)) == corpus_loaded || status == corpus_malformed) {
+        if (status == corpus_loaded && corpus_write(out, sudoku))
+            continue;
+        fprintf(stderr, "Line %lu: failed to load input\n", line);
+        all_packed = false;
+    }
+    if (status == corpus_failed) {
+        fprintf(stderr, "Failed to read input\n");
+        all_packed = false;
+    }
+    all_packed &= corpus_finish(out);
+    corpus_close(in);
+    return all_packed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int batch_demo(const char *path, const struct solver *solver, int threads, bool lockstep, struct cache *cache)
+{
+    struct corpus *in = corpus_open(path);
+    if (in == NULL)
+        return EXIT_FAILURE;
+
+    bool done = batch_solve(in, stdout, solver->batch_solve, worker_threads(threads), lockstep, cache);
+    corpus_close(in);
+    if (fflush(stdout) != 0) {
+        perror("stdout");
+        return EXIT_FAILURE;
+    }
+    return done ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static const struct engine *parse_size(const char *optarg)
+{
+    static const struct engine *const engines[] = { &engine9, &engine16, &engine25 };
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+        if (strlen(optarg) == 1 && optarg[0] - '0' == engines[i]->box)
+            return engines[i];
+    }
+
+    fprintf(stderr, "Unsupported box size %s\n", optarg);
+    return NULL;
+}
+
+// larger sudokus one by one, with --solver=parallel every search is split among threads
+static int engine_batch_demo(const char *path, const struct engine *engine, int threads)
+{
+    FILE *in = path ? fopen(path, "r") : stdin;
+    if (in == NULL) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    size_t cells = (size_t) engine->side * engine->side;
+    uint32_t sudoku[ENGINE_MAX_CELLS];
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    unsigned long number = 0;
+    bool all_solved = true;
+    while ((length = getline(&line, &capacity, in)) != -1) {
+        ++number;
+        if (length > 0 && line[length - 1] == '\n')
+            --length;
+        if (length > 0 && line[length - 1] == '\r')
+            --length;
+        if (length == 0)
+            continue;
+
+        if (!engine->parse(sudoku, line, (size_t) length)) {
+            fprintf(stderr, "Line %lu: failed to load input\n", number);
+            all_solved = false;
+            putchar('\n');
+            continue;
+        }
+        int found = threads > 1 ? parallel_count_engine(engine, sudoku, 1, threads)
+                                : engine->count_solutions_until(sudoku, 1, NULL);
+        if (found < 0) {
+            fprintf(stderr, "Failed to start worker threads\n");
+            all_solved = false;
+            break;
+        }
+        if (found == 0) {
+            fprintf(stderr, "Line %lu: no solution\n", number);
+            all_solved = false;
+        }
+        // the line holds at least cells + 1 characters
+        engine->format(sudoku, line);
+        line[cells] = '\n';
+        fwrite(line, 1, cells + 1, stdout);
+    }
+    if (ferror(in)) {
+        fprintf(stderr, "Failed to read input\n");
+        all_solved = false;
+    }
+
+    free(line);
+    if (in != stdin)
+        fclose(in);
+    if (fflush(stdout) != 0) {
+        perror("stdout");
+        return EXIT_FAILURE;
+    }
+    return all_solved ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
+
+static bool parse_strategies(const char *optarg, unsigned int *selected)
+{
+    static const struct
+    {
+        const char *name;
+        unsigned int strategies;
+    } names[] = {
+        { "hidden-singles", strategy_hidden_singles },
+        { "naked-pairs", strategy_naked_pairs },
+        { "hidden-pairs", strategy_hidden_pairs },
+        { "box-line", strategy_box_line },
+        { "all", strategy_all },
+        { "none", 0 },
+    };
+
+    *selected = 0;
+    const char *name = optarg;
+    while (*name != '\0') {
+        size_t length = strcspn(name, ",");
+        size_t i = 0;
+        while (i < sizeof(names) / sizeof(names[0])
+                && (strlen(names[i].name) != length || strncmp(name, names[i].name, length) != 0))
+            ++i;
+        if (i == sizeof(names) / sizeof(names[0])) {
+            fprintf(stderr, "Unknown strategy %.*s\n", (int) length, name);
+            return false;
+        }
+        *selected |= names[i].strategies;
+        name += length + (name[length] == ',');
+    }
+    return true;
+}
+
+static bool parse_count(const char *optarg, const char *what, long max, long *count)
+{
+    char *endptr = NULL;
+    *count = strtol(optarg, &endptr, 10);
+
+    if (*endptr != '\0' || endptr == optarg || *count < 0 || *count > max) {
+        fprintf(stderr, "Invalid %s %s\n", what, optarg);
+        return false;
+    }
+    return true;
+}
+
+static void count_solutions_demo(unsigned int sudoku[9][9], const char *optarg, int silent)
+{
+    long limit = 2;
+    if (optarg != NULL && !parse_count(optarg, "solution limit", 1000000000, &limit))
+        return;
+    if (limit == 0) {
+        fprintf(stderr, "Invalid solution limit %s\n", optarg);
+        return;
+    }
+
+    if (silent < SILENCE_NO_REPORT)
+        printf(CYAN "\nCOUNT SOLUTIONS UP TO %ld\n" RESET, limit);
+
+    int count = search_threads > 1 ? parallel_count_solutions(sudoku, (int) limit, search_threads)
+                                   : count_solutions(sudoku, (int) limit);
+    if (count < 0) {
+        fprintf(stderr, "Failed to start worker threads\n");
+        return;
+    }
+    if (silent >= SILENCE_NO_RESULT)
+        return;
+    if (count == 0)
+        puts(RED "NO SOLUTION" RESET);
+    else if (count == 1 && limit > 1)
+        puts(GREEN "UNIQUE" RESET);
+    else if (limit == 1)
+        puts(GREEN "SOLVABLE" RESET);
+    else if (count == limit)
+        printf(YELLOW "AT LEAST %d SOLUTIONS\n" RESET, count);
+    else
+        printf(YELLOW "%d SOLUTIONS\n" RESET, count);
+}
+
 static void init_rand(const char *optarg)
 {
     char *endptr = NULL;
@@ -231,6 +526,42 @@ static void init_rand(const char *optarg)
     srand(seed);
 }
 
+#if defined(BONUS_GENERATE)
+static bool parse_difficulty(const char *optarg, int *level)
+{
+    static const char *const names[] = { "easy", "medium", "hard", "expert" };
+    for (int i = 0; i < 4; ++i) {
+        if (strcmp(optarg, names[i]) == 0) {
+            *level = i;
+            return true;
+        }
+    }
+
+    fprintf(stderr, "Unknown difficulty %s\n", optarg);
+    return false;
+}
+
+static int generate_batch_demo(unsigned long count, const char *seed, int clues, int level, int threads)
+{
+    uint64_t random_seed = (uint64_t) time(NULL);
+    if (seed != NULL) {
+        char *endptr = NULL;
+        random_seed = strtoull(seed, &endptr, 10);
+        if (*endptr != '\0' || endptr == seed) {
+            fprintf(stderr, "Invalid seed %s\n", seed);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool done = batch_generate(stdout, count, random_seed, clues, level, worker_threads(threads));
+    if (fflush(stdout) != 0) {
+        perror("stdout");
+        return EXIT_FAILURE;
+    }
+    return done ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
+
 int main(int argc, char **argv)
 {
     srand(time(NULL));
@@ -241,6 +572,25 @@ int main(int argc, char **argv)
 
     bool valid_load = false;
     int silent = 0;
+    unsigned int solve_mask = strategy_all;
+    unsigned int search_mask = strategy_hidden_singles;
+    int threads = 0;
+#if defined(BONUS_GENERIC_SOLVE)
+    const struct solver *solver = &solvers[0];
+    bool batch = false;
+    const char *batch_path = NULL;
+    bool lockstep = true;
+    const struct engine *engine = &engine9;
+    bool use_cache = false;
+    const char *cache_path = NULL;
+    const char *pack_path = NULL;
+    struct cache *cache = NULL;
+#endif
+#if defined(BONUS_GENERATE)
+    long generate_count = 0, clues = 0;
+    int level = -1;
+    const char *seed = NULL;
+#endif
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--help") == 0) {
@@ -252,8 +602,115 @@ int main(int argc, char **argv)
             valid_load = true;
         } else if (strcmp(argv[i], "--silent") == 0) {
             ++silent;
+        } else if (strcmp(argv[i], "--strategies") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing option argument for %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            if (!parse_strategies(argv[++i], &solve_mask))
+                return EXIT_FAILURE;
+        } else if (strcmp(argv[i], "--search-strategies") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing option argument for %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            if (!parse_strategies(argv[++i], &search_mask))
+                return EXIT_FAILURE;
+#if defined(BONUS_GENERIC_SOLVE)
+        } else if (strncmp(argv[i], "--solver=", 9) == 0) {
+            if ((solver = find_solver(argv[i] + 9)) == NULL)
+                return EXIT_FAILURE;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+                batch_path = argv[++i];
+        } else if (strcmp(argv[i], "--no-lockstep") == 0) {
+            lockstep = false;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            use_cache = true;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+                cache_path = argv[++i];
+        } else if (strcmp(argv[i], "--pack") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing option argument for %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            pack_path = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing option argument for %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            if ((engine = parse_size(argv[++i])) == NULL)
+                return EXIT_FAILURE;
+#endif
+#if defined(BONUS_GENERATE)
+        } else if (strcmp(argv[i], "--generate-batch") == 0 || strcmp(argv[i], "--clues") == 0
+                || strcmp(argv[i], "--difficulty") == 0 || strcmp(argv[i], "--seed") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing option argument for %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            const char *option = argv[i++];
+            if (strcmp(option, "--seed") == 0)
+                seed = argv[i];
+            else if (strcmp(option, "--difficulty") == 0 && !parse_difficulty(argv[i], &level))
+                return EXIT_FAILURE;
+            else if (strcmp(option, "--clues") == 0 && !parse_count(argv[i], "clue count", 81, &clues))
+                return EXIT_FAILURE;
+            else if (strcmp(option, "--generate-batch") == 0
+                    && (!parse_count(argv[i], "sudoku count", 1000000000, &generate_count) || generate_count == 0))
+                return EXIT_FAILURE;
+#endif
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing option argument for %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            if ((threads = parse_threads(argv[++i])) == 0)
+                return EXIT_FAILURE;
+        }
+    }
+    select_strategies(solve_mask, search_mask);
+#if defined(BONUS_GENERIC_SOLVE)
+    if (strcmp(solver->name, "parallel") == 0)
+        search_threads = worker_threads(threads);
+#endif
+
+#if defined(BONUS_GENERIC_SOLVE)
+    if (pack_path != NULL) {
+        if (!batch || engine != &engine9) {
+            fprintf(stderr, "Option --pack takes 9x9 sudokus of --batch\n");
+            return EXIT_FAILURE;
         }
+        return pack_demo(batch_path, pack_path);
     }
+    if (batch && engine != &engine9) {
+        if (strcmp(solver->name, "dlx") == 0) {
+            fprintf(stderr, "Solver dlx takes 9x9 sudokus only\n");
+            return EXIT_FAILURE;
+        }
+        if (use_cache) {
+            fprintf(stderr, "Cache takes 9x9 sudokus only\n");
+            return EXIT_FAILURE;
+        }
+        return engine_batch_demo(batch_path, engine, search_threads);
+    }
+    if (use_cache && (cache = cache_path ? cache_open(cache_path) : cache_create()) == NULL) {
+        if (!cache_path)
+            fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    if (batch) {
+        int result = batch_demo(batch_path, solver, threads, lockstep, cache);
+        cache_close(cache);
+        return result;
+    }
+#endif
+#if defined(BONUS_GENERATE)
+    if (generate_count > 0)
+        return generate_batch_demo((unsigned long) generate_count, seed, (int) clues, level, threads);
+#endif
 
     if (!valid_load) {
         if (silent < SILENCE_NO_REPORT)
@@ -301,16 +758,36 @@ int main(int argc, char **argv)
             if (silent < SILENCE_NO_REPORT)
                 puts(BLUE "\nGENERATE" RESET);
 
-            generate(sudoku);
+            if (clues == 0 && level < 0) {
+                generate(sudoku);
+            } else if (!generate_puzzle(sudoku, ((uint64_t) rand() << 32) ^ (uint64_t) rand(), (int) clues, level)) {
+                if (silent < SILENCE_NO_RESULT)
+                    puts(RED "FAILED" RESET);
+            }
+        } else if (strcmp(option, "--generate-batch") == 0 || strcmp(option, "--clues") == 0
+                || strcmp(option, "--difficulty") == 0) {
+            ++argi; // chosen before loading
 #endif
 #if defined(BONUS_GENERIC_SOLVE)
         } else if (strcmp(option, "--generic-solve") == 0) {
             if (silent < SILENCE_NO_REPORT)
                 puts(BLUE "\nGENERIC_SOLVE" RESET);
 
-            bool done = generic_solve(sudoku);
+            struct cache_key key;
+            bool done = cache != NULL && cache_lookup(cache, sudoku, &key);
+            if (!done && (done = solver->solve(sudoku)) && cache != NULL)
+                cache_store(cache, &key, sudoku);
             if (silent < SILENCE_NO_RESULT)
                 puts(done ? GREEN "SOLVED" RESET : RED "FAILED" RESET);
+        } else if (strncmp(option, "--solver=", 9) == 0) {
+            ; // nop, chosen before loading
+        } else if (strcmp(option, "--no-lockstep") == 0) {
+            ; // nop, only used by --batch
+        } else if (strcmp(option, "--cache") == 0) {
+            if (argi + 1 < argc && strncmp(optarg, "--", 2) != 0)
+                ++argi; // opened before loading
+        } else if (strcmp(option, "--size") == 0 || strcmp(option, "--pack") == 0) {
+            ++argi; // only used by --batch
 #endif
         } else if (strcmp(option, "--needs-solving") == 0) {
             if (silent < SILENCE_NO_REPORT)
@@ -324,6 +801,15 @@ int main(int argc, char **argv)
 
             if (silent < SILENCE_NO_RESULT)
                 puts(is_valid(sudoku) ? GREEN "OK" RESET : RED "FAIL" RESET);
+        } else if (strcmp(option, "--count-solutions") == 0) {
+            const char *limit = NULL;
+            // a limit starts with a digit, parse_count() rejects the rest of a bad one
+            if (argi + 1 < argc && isdigit((unsigned char) optarg[0])) {
+                limit = optarg;
+                ++argi;
+            }
+
+            count_solutions_demo(sudoku, limit, silent);
         } else if (strcmp(option, "--eliminate-row") == 0) {
             if (argi + 1 >= argc) {
                 fprintf(stderr, "Missing option argument for %s\n", option);
@@ -364,6 +850,11 @@ int main(int argc, char **argv)
                 if (silent < SILENCE_NO_RESULT)
                     puts(RED "FAILED" RESET);
             }
+        } else if (strcmp(option, "--strategies") == 0
+                || strcmp(option, "--search-strategies") == 0) {
+            ++argi; // chosen before loading
+        } else if (strcmp(option, "--threads") == 0) {
+            ++argi; // only used by batch modes
         } else if (strcmp(option, "--silent") == 0) {
             ; // nop
         } else {
@@ -372,5 +863,8 @@ int main(int argc, char **argv)
         }
     }
 
+#if defined(BONUS_GENERIC_SOLVE)
+    cache_close(cache);
+#endif
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,226 @@
+#include "parallel.h"
+#include "engine.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* written under the lock, count_solutions_until() reads it without */
+#if defined(__GNUC__)
+#define REQUEST_STOP(search) __atomic_store_n(&(search)->stop, 1, __ATOMIC_RELAXED)
+#else
+#define REQUEST_STOP(search) ((search)->stop = 1)
+#endif
+
+/* cells of any engine, engine->size bytes are used */
+struct task {
+    uint32_t sudoku[ENGINE_MAX_CELLS];
+    int depth;
+};
+
+/* the owner pushes and pops at the bottom, thieves take the top (the shallowest tasks) */
+struct deque {
+    pthread_mutex_t lock;
+    struct task *tasks;
+    size_t top, bottom, capacity;
+};
+
+struct search {
+    const struct engine *engine;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    struct deque *deques;
+    int threads;
+
+    /* tasks in deques not yet taken, tasks pushed and not finished yet */
+    size_t queued, pending;
+    int limit, found;
+    /* set once limit solutions are found, read by count_solutions_until() */
+    volatile int stop;
+    bool failed;
+    uint32_t solution[ENGINE_MAX_CELLS];
+};
+
+struct worker {
+    struct search *search;
+    int index;
+};
+
+static bool deque_push(struct deque *deque, const struct task *task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == deque->capacity) {
+        /* reuse the space of stolen tasks before growing */
+        size_t count = deque->bottom - deque->top;
+        if (deque->top > deque->capacity / 2) {
+            memmove(deque->tasks, deque->tasks + deque->top, count * sizeof(struct task));
+        } else {
+            size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+            struct task *tasks = malloc(capacity * sizeof(struct task));
+            if (!tasks) {
+                pthread_mutex_unlock(&deque->lock);
+                return false;
+            }
+            if (count > 0) { memcpy(tasks, deque->tasks + deque->top, count * sizeof(struct task)); }
+            free(deque->tasks);
+            deque->tasks = tasks;
+            deque->capacity = capacity;
+        }
+        deque->top = 0;
+        deque->bottom = count;
+    }
+    deque->tasks[deque->bottom++] = *task;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+static bool deque_take(struct deque *deque, struct task *task, bool steal) {
+    pthread_mutex_lock(&deque->lock);
+    bool taken = deque->top < deque->bottom;
+    if (taken) { *task = steal ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom]; }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+static void push_task(struct search *search, int index, const struct task *task) {
+    bool pushed = deque_push(&search->deques[index], task);
+    pthread_mutex_lock(&search->lock);
+    if (pushed) {
+        search->queued++;
+        search->pending++;
+        pthread_cond_signal(&search->changed);
+    } else {
+        /* out of memory, the answer would not be reliable */
+        search->failed = true;
+        REQUEST_STOP(search);
+        pthread_cond_broadcast(&search->changed);
+    }
+    pthread_mutex_unlock(&search->lock);
+}
+
+/* waits for a queued task, false once the search is over */
+static bool take_task(struct search *search, int index, struct task *task) {
+    pthread_mutex_lock(&search->lock);
+    while (search->queued == 0 && search->pending > 0 && !search->stop) {
+        pthread_cond_wait(&search->changed, &search->lock);
+    }
+    bool available = search->queued > 0 && !search->stop;
+    if (available) { search->queued--; }
+    pthread_mutex_unlock(&search->lock);
+    if (!available) { return false; }
+
+    /* one task is reserved for this thread, so some deque holds it */
+    for (int i = 0;; i = (i + 1) % search->threads) {
+        int victim = (index + i) % search->threads;
+        if (deque_take(&search->deques[victim], task, victim != index)) { return true; }
+    }
+}
+
+static void finish_task(struct search *search, const void *sudoku, int found, bool holds_solution) {
+    pthread_mutex_lock(&search->lock);
+    if (found > 0 && !search->stop) {
+        search->found = search->found + found < search->limit ? search->found + found : search->limit;
+        if (holds_solution) { memcpy(search->solution, sudoku, search->engine->size); }
+        if (search->found == search->limit) { REQUEST_STOP(search); }
+    }
+    if (--search->pending == 0 || search->stop) { pthread_cond_broadcast(&search->changed); }
+    pthread_mutex_unlock(&search->lock);
+}
+
+static void run_task(struct search *search, int index, struct task *task) {
+    const struct engine *engine = search->engine;
+    if (task->depth >= SPLIT_DEPTH) {
+        pthread_mutex_lock(&search->lock);
+        int limit = search->limit - search->found;
+        pthread_mutex_unlock(&search->lock);
+        int found = engine->count_solutions_until(task->sudoku, limit, &search->stop);
+        finish_task(search, task->sudoku, found, found == limit);
+        return;
+    }
+
+    int cell = engine->branch_cell(task->sudoku);
+    if (cell == engine->side * engine->side) {
+        finish_task(search, task->sudoku, 1, true);
+        return;
+    }
+    if (cell >= 0) {
+        /* pushed in reverse, so the owner pops them lowest digit first */
+        unsigned int candidates = engine->candidates(task->sudoku, cell);
+        for (int digit = engine->side - 1; digit >= 0; digit--) {
+            if (!(candidates & (1u << digit))) { continue; }
+            struct task child;
+            memcpy(child.sudoku, task->sudoku, engine->size);
+            child.depth = task->depth + 1;
+            engine->place(child.sudoku, cell, 1u << digit);
+            push_task(search, index, &child);
+        }
+    }
+    finish_task(search, task->sudoku, 0, false);
+}
+
+static void *worker_thread(void *data) {
+    struct worker *worker = data;
+    struct task task;
+    while (take_task(worker->search, worker->index, &task)) {
+        run_task(worker->search, worker->index, &task);
+    }
+    return NULL;
+}
+
+int parallel_count_engine(const struct engine *engine, void *sudoku, int limit, int threads) {
+    if (limit < 1) { return 0; }
+
+    struct search search = {.engine = engine, .threads = threads, .limit = limit};
+    search.deques = calloc((size_t) threads, sizeof(struct deque));
+    pthread_t *ids = malloc((size_t) threads * sizeof(pthread_t));
+    struct worker *workers = malloc((size_t) threads * sizeof(struct worker));
+    if (!search.deques || !ids || !workers) {
+        free(search.deques);
+        free(ids);
+        free(workers);
+        return -1;
+    }
+    pthread_mutex_init(&search.lock, NULL);
+    pthread_cond_init(&search.changed, NULL);
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&search.deques[i].lock, NULL);
+    }
+
+    struct task root = {.depth = 0};
+    memcpy(root.sudoku, sudoku, engine->size);
+    push_task(&search, 0, &root);
+
+    int started = 0;
+    while (started < threads) {
+        workers[started].search = &search;
+        workers[started].index = started;
+        if (pthread_create(&ids[started], NULL, worker_thread, &workers[started]) != 0) { break; }
+        started++;
+    }
+    /* deques of workers that did not start stay empty */
+    if (started == 0) { search.failed = true; }
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&search.deques[i].lock);
+        free(search.deques[i].tasks);
+    }
+    pthread_cond_destroy(&search.changed);
+    pthread_mutex_destroy(&search.lock);
+    free(search.deques);
+    free(ids);
+    free(workers);
+
+    if (search.failed) { return -1; }
+    if (limit == 1 && search.found == 1) { memcpy(sudoku, search.solution, engine->size); }
+    return search.found;
+}
+
+int parallel_count_solutions(unsigned int sudoku[9][9], int limit, int threads) {
+    return parallel_count_engine(&engine9, sudoku, limit, threads);
+}
+
+bool parallel_solve(unsigned int sudoku[9][9], int threads) {
+    return parallel_count_solutions(sudoku, 1, threads) == 1;
+}
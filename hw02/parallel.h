@@ -0,0 +1,47 @@
+/**
+ * @file parallel.h
+ * @brief Search of one sudoku split among threads.
+ *
+ * The shallow levels of the search tree become tasks, every thread takes
+ * them from the bottom of its own deque and steals from the top of the
+ * others' when it runs out. Below SPLIT_DEPTH a task is searched by
+ * count_solutions_until() of the engine, which gives up as soon as enough solutions
+ * are found by any thread.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "engine.h"
+
+#include <stdbool.h>
+
+/** levels of guesses split into tasks */
+#define SPLIT_DEPTH 5
+
+/**
+ * @brief Count solutions up to limit on threads workers.
+ *
+ * @param sudoku 2D array of digit bitsets, not changed unless limit is 1,
+ * it then holds the solution found
+ * @return number of solutions up to limit, 0 for an invalid sudoku,
+ * -1 if the threads could not be started
+ */
+int parallel_count_solutions(unsigned int sudoku[9][9], int limit, int threads);
+
+/**
+ * @brief parallel_count_solutions() for sudokus of any engine.
+ *
+ * @param sudoku of the engine
+ */
+int parallel_count_engine(const struct engine *engine, void *sudoku, int limit, int threads);
+
+/**
+ * @brief Solve the sudoku on threads workers, the first solution found
+ * stops the others. Silent.
+ *
+ * @return true if solved
+ */
+bool parallel_solve(unsigned int sudoku[9][9], int threads);
+
+#endif //PARALLEL_H
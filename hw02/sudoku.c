@@ -1,77 +1,56 @@
 #include "sudoku.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static int convert_to_decimal(unsigned int digit);
 
 static unsigned int bitset_add(unsigned int original, int number);
 
-static unsigned int bitset_drop(unsigned int original, int number);
+static int bitset_count(unsigned int original);
 
-static bool bitset_is_set(unsigned int original, int query);
+static bool drop_seen(unsigned int *cell, unsigned int seen);
 
 static bool bitset_is_unique(unsigned int original);
 
 bool eliminate_row(unsigned int sudoku[9][9], int row_index) {
-    int seen[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0}, changes = 0;
+    unsigned int seen = 0;
     for (int i = 0; i < 9; i++) {
-        if (bitset_is_unique(sudoku[row_index][i])) { seen[i] = convert_to_decimal(sudoku[row_index][i]); }
+        if (bitset_is_unique(sudoku[row_index][i])) { seen |= sudoku[row_index][i]; }
     }
+    bool changed = false;
     for (int i = 0; i < 9; i++) {
-        if (!bitset_is_unique(sudoku[row_index][i])) {
-            for (int j = 0; j < 9; j++) {
-                if (seen[j] != 0 && bitset_is_set(sudoku[row_index][i], seen[j])) {
-                    changes++;
-                    sudoku[row_index][i] = bitset_drop(sudoku[row_index][i], seen[j]);
-                }
-            }
-        }
+        changed |= drop_seen(&sudoku[row_index][i], seen);
     }
-    return changes > 0;
+    return changed;
 }
 
 bool eliminate_col(unsigned int sudoku[9][9], int col_index) {
-    int seen[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0}, changes = 0;
+    unsigned int seen = 0;
     for (int i = 0; i < 9; i++) {
-        if (bitset_is_unique(sudoku[i][col_index])) { seen[i] = convert_to_decimal(sudoku[i][col_index]); }
+        if (bitset_is_unique(sudoku[i][col_index])) { seen |= sudoku[i][col_index]; }
     }
+    bool changed = false;
     for (int i = 0; i < 9; i++) {
-        if (!bitset_is_unique(sudoku[i][col_index])) {
-            for (int j = 0; j < 9; j++) {
-                if (seen[j] != 0 && bitset_is_set(sudoku[i][col_index], seen[j])) {
-                    changes++;
-                    sudoku[i][col_index] = bitset_drop(sudoku[i][col_index], seen[j]);
-                }
-            }
-        }
+        changed |= drop_seen(&sudoku[i][col_index], seen);
     }
-    return changes > 0;
+    return changed;
 }
 
 bool eliminate_box(unsigned int sudoku[9][9], int row_index, int col_index) {
-    int seen[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0}, changes = 0, i = 0;
-    int max_row = row_index + 3, max_col = col_index + 3;
-    for (int row = row_index; row < max_row; row++) {
-        for (int col = col_index; col < max_col; col++) {
-            if (bitset_is_unique(sudoku[row][col])) {
-                seen[i] = convert_to_decimal(sudoku[row][col]);
-            }
-            i++;
+    unsigned int seen = 0;
+    for (int row = row_index; row < row_index + 3; row++) {
+        for (int col = col_index; col < col_index + 3; col++) {
+            if (bitset_is_unique(sudoku[row][col])) { seen |= sudoku[row][col]; }
         }
     }
-    for (int row = row_index; row < max_row; row++) {
-        for (int col = col_index; col < max_col; col++) {
-            if (!bitset_is_unique(sudoku[row][col])) {
-                for (int j = 0; j < 9; j++) {
-                    if (seen[j] != 0 && bitset_is_set(sudoku[row][col], seen[j])) {
-                        changes++;
-                        sudoku[row][col] = bitset_drop(sudoku[row][col], seen[j]);
-                    }
-                }
-            }
+    bool changed = false;
+    for (int row = row_index; row < row_index + 3; row++) {
+        for (int col = col_index; col < col_index + 3; col++) {
+            changed |= drop_seen(&sudoku[row][col], seen);
         }
     }
-    return changes > 0;
+    return changed;
 }
 
 bool needs_solving(unsigned int sudoku[9][9]) {
@@ -118,25 +97,134 @@ bool is_valid(unsigned int sudoku[9][9]) {
     return true;
 }
 
+#define BOX 3
+#define CELL unsigned int
+#define ENGINE engine9
+#include "engine_impl.h"
+
+/* stronger strategies pay off in solve(), in a search they cost more than they save */
+static unsigned int solve_strategies = strategy_all;
+static unsigned int search_strategies = strategy_hidden_singles;
+
+void select_strategies(unsigned int solve, unsigned int search) {
+    solve_strategies = solve & strategy_all;
+    search_strategies = search & strategy_all;
+}
+
+unsigned int engine_search_strategies(void) { return search_strategies; }
+
 bool solve(unsigned int sudoku[9][9]) {
-    while (needs_solving(sudoku)) {
-        int changes = 0;
-        for (int i = 0; i < 9; i++) {
-            if (eliminate_row(sudoku, i)) { changes++; }
-        }
-        for (int i = 0; i < 9; i++) {
-            if (eliminate_col(sudoku, i)) { changes++; }
-        }
-        for (int i = 0; i < 9; i += 3) {
-            for (int j = 0; j < 9; j += 3) {
-                if (eliminate_box(sudoku, i, j)) { changes++; }
-            }
-        }
-        if (!changes) {
-            return false;
+    struct grid grid;
+    if (!grid_init(&grid, sudoku, solve_strategies) || !propagate(&grid)) {
+        fprintf(stderr, "Invalid sudoku\n");
+        return false;
+    }
+    return !needs_solving(sudoku);
+}
+
+bool backtrack_solve(unsigned int sudoku[9][9]) {
+    struct grid grid;
+    int found = 0;
+    return grid_init(&grid, sudoku, search_strategies) && propagate(&grid) && search(&grid, 1, &found);
+}
+
+int count_solutions_until(unsigned int sudoku[9][9], int limit, const volatile int *stop) {
+    return engine_count_solutions_until(sudoku, limit, stop);
+}
+
+int count_solutions(unsigned int sudoku[9][9], int limit) {
+    return count_solutions_until(sudoku, limit, NULL);
+}
+
+int branch_cell(unsigned int sudoku[9][9]) {
+    return engine_branch_cell(sudoku);
+}
+
+int grade(unsigned int sudoku[9][9]) {
+    static const unsigned int LEVELS[] = {0, strategy_hidden_singles, strategy_all};
+    for (int level = 0; level < 3; level++) {
+        unsigned int copy[9][9];
+        memcpy(copy, sudoku, sizeof(copy));
+        struct grid grid;
+        if (!grid_init(&grid, copy, LEVELS[level]) || !propagate(&grid)) { return -1; }
+        if (!needs_solving(copy)) { return level; }
+    }
+    return grade_expert;
+}
+
+/* a random complete grid */
+static void random_solution(unsigned int sudoku[9][9], uint64_t *random) {
+    struct grid grid;
+    int found = 0;
+    for (int i = 0; i < 81; i++) {
+        sudoku[i / 9][i % 9] = 511;
+    }
+    grid_init(&grid, sudoku, search_strategies);
+    grid.random = random;
+    search(&grid, 1, &found);
+}
+
+/* true if the sudoku without the given digit of the cell still has the same single solution */
+static bool removable(unsigned int sudoku[9][9], int row, int col) {
+    unsigned int copy[9][9];
+    memcpy(copy, sudoku, sizeof(copy));
+    copy[row][col] = 511 & ~sudoku[row][col];
+    struct grid grid;
+    int found = 0;
+    return !grid_init(&grid, copy, search_strategies) || !propagate(&grid) || !search(&grid, 1, &found);
+}
+
+static int count_clues(unsigned int sudoku[9][9]) {
+    int clues = 0;
+    for (int i = 0; i < 81; i++) {
+        clues += sudoku[i / 9][i % 9] != 511;
+    }
+    return clues;
+}
+
+/* one attempt from a new random grid, removes clues in random order while the solution stays unique */
+static void generate_attempt(unsigned int sudoku[9][9], uint64_t *random, int clues, int level) {
+    int order[81];
+    random_solution(sudoku, random);
+    for (int i = 0; i < 81; i++) {
+        int j = (int) random_below(random, (unsigned int) i + 1);
+        order[i] = order[j];
+        order[j] = i;
+    }
+    int left = 81;
+    for (int i = 0; i < 81 && left > clues; i++) {
+        int row = order[i] / 9, col = order[i] % 9;
+        unsigned int digit = sudoku[row][col];
+        if (!removable(sudoku, row, col)) { continue; }
+        sudoku[row][col] = 511;
+        if (level >= 0 && grade(sudoku) > level) {
+            sudoku[row][col] = digit;
+            continue;
         }
+        left--;
     }
-    return true;
+}
+
+bool generate_puzzle(unsigned int sudoku[9][9], uint64_t seed, int clues, int level) {
+    uint64_t random = seed;
+    for (int attempt = 0; attempt < GENERATE_ATTEMPTS; attempt++) {
+        generate_attempt(sudoku, &random, clues, level);
+        if ((clues == 0 || count_clues(sudoku) <= clues) && (level < 0 || grade(sudoku) == level)) { return true; }
+    }
+    return false;
+}
+
+void generate(unsigned int sudoku[9][9]) {
+    uint64_t seed = ((uint64_t) rand() << 32) ^ (uint64_t) rand();
+    generate_puzzle(sudoku, seed, 0, -1);
+}
+
+bool generic_solve(unsigned int sudoku[9][9]) {
+    if (!is_valid(sudoku)) {
+        fprintf(stderr, "Invalid sudoku\n");
+        return false;
+    }
+    return backtrack_solve(sudoku);
 }
 
 #define DIGITS "0123456789"
@@ -231,26 +319,25 @@ void print(unsigned int sudoku[9][9]) {
 }
 
 static int convert_to_decimal(unsigned int digit) {
+#if defined(__GNUC__)
+    return digit ? __builtin_ctz(digit) + 1 : 0;
+#else
     int count = 0;
     while (digit) {
         digit >>= 1;
         count++;
     }
     return count;
+#endif
 }
 
 static unsigned int bitset_add(unsigned int original, int number) {
     return original | (1 << (number - 1));
 }
 
-static unsigned int bitset_drop(unsigned int original, int number) {
-    return original ^ (1 << (number - 1));
-}
-
-static bool bitset_is_set(unsigned int original, int query) {
-    return (original & (1 << (query - 1))) != 0;
-}
-
-static bool bitset_is_unique(unsigned int original) {
-    return !(original & (original - 1));
+/* removes the seen digits from the unknown cell, true if any was there */
+static bool drop_seen(unsigned int *cell, unsigned int seen) {
+    if (bitset_is_unique(*cell) || !(*cell & seen)) { return false; }
+    *cell &= ~seen;
+    return true;
 }
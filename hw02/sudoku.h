@@ -11,14 +11,15 @@
 
 // The two lines below enable bonus code in the attached main. 
 // Uncomment when implemented.
-//#define BONUS_GENERIC_SOLVE
-//#define BONUS_GENERATE
+#define BONUS_GENERIC_SOLVE
+#define BONUS_GENERATE
 
 #ifndef SUDOKU_H
 #define SUDOKU_H
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* ************************************************************** *
  *          Remove set digits from squares with unknown           *
@@ -78,6 +79,9 @@ bool is_valid(unsigned int sudoku[9][9]);
  * @brief Solve the sudoku using elimination as much as possible
  * without guessing or backtracking.
  *
+ * Besides naked singles, the strategies chosen by select_strategies()
+ * are applied.
+ *
  * If you fully solve the sudoku return true, otherwise false.
  *
  * @note In case the sudoku is invalid, reports to user with one
@@ -88,6 +92,38 @@ bool is_valid(unsigned int sudoku[9][9]);
  */
 bool solve(unsigned int sudoku[9][9]);
 
+/* ************************************************************** *
+ *                     Elimination strategies                     *
+ * ************************************************************** */
+
+/**
+ * Strategies used by solve() and the solvers besides naked singles,
+ * a bitwise or of the values below.
+ */
+enum strategy {
+    /** a digit possible in one cell of a unit only */
+    strategy_hidden_singles = 1,
+    /** two cells of a unit with the same two candidates */
+    strategy_naked_pairs = 2,
+    /** two digits possible in the same two cells of a unit only */
+    strategy_hidden_pairs = 4,
+    /** pointing and claiming, candidates of a box in one line or vice versa */
+    strategy_box_line = 8,
+    strategy_all = 15
+};
+
+/**
+ * @brief Select the strategies of solve() and of the searching solvers.
+ *
+ * Stronger elimination costs more time per step but leaves smaller
+ * search trees. By default solve() uses all of them and the search
+ * hidden singles only. Not thread-safe, no solver may run meanwhile.
+ *
+ * @param solve bitwise or of enum strategy values used by solve()
+ * @param search the same for every step of generic_solve()
+ */
+void select_strategies(unsigned int solve, unsigned int search);
+
 /* ************************************************************** *
  *                          Input/Output                          *
  * ************************************************************** */
@@ -145,11 +181,121 @@ void print(unsigned int sudoku[9][9]);
  * ************************************************************** */
 
 #ifdef BONUS_GENERATE
+/**
+ * @brief Generate a sudoku with a unique solution, removing digits
+ * as long as the solution stays unique.
+ *
+ * Uses rand(), so srand() makes the result deterministic.
+ *
+ * @param sudoku 2D array to store digit bitsets, passed in undefined state.
+ */
 void generate(unsigned int sudoku[9][9]);
 #endif
 
 #ifdef BONUS_GENERIC_SOLVE
+/**
+ * @brief Solve any sudoku, guessing where elimination is not enough.
+ *
+ * The cell with the fewest candidates is guessed first and every guess
+ * is followed by elimination, wrong guesses are undone.
+ *
+ * @note In case the sudoku is invalid, reports to user with one
+ * line message on STDERR and returns false.
+ *
+ * @param sudoku 2D array of digit bitsets
+ * @return true if solved, false if there is no solution
+ */
 bool generic_solve(unsigned int sudoku[9][9]);
 #endif
 
+/* ************************************************************** *
+ *                        Solver backends                         *
+ * ************************************************************** */
+
+/** complete solver of one sudoku, silent on invalid input */
+typedef bool (*sudoku_solver)(unsigned int sudoku[9][9]);
+
+/**
+ * @brief Backtracking solver behind generic_solve(), reports nothing.
+ *
+ * Reentrant, all state lives on the stack of the caller.
+ *
+ * @param sudoku 2D array of digit bitsets
+ * @return true if solved, false if invalid or there is no solution
+ */
+bool backtrack_solve(unsigned int sudoku[9][9]);
+
+/**
+ * @brief Count solutions, stopping once limit of them are found.
+ *
+ * One search enumerates them all, so checking that a sudoku has exactly
+ * one solution takes a limit of 2. Reentrant and silent.
+ *
+ * @param sudoku 2D array of digit bitsets, holds the last solution found
+ * if the limit is reached, otherwise only elimination is applied to it
+ * @param limit maximal count of interest
+ * @return number of solutions up to limit, 0 for an invalid sudoku
+ */
+int count_solutions(unsigned int sudoku[9][9], int limit);
+
+/**
+ * @brief count_solutions() that gives up once *stop becomes non-zero,
+ * for searches split among threads.
+ *
+ * @return number of solutions found until then
+ */
+int count_solutions_until(unsigned int sudoku[9][9], int limit, const volatile int *stop);
+
+/**
+ * @brief Apply elimination and choose the cell to guess next.
+ *
+ * @param sudoku 2D array of digit bitsets, elimination is applied to it
+ * @return index (row * 9 + col) of an unknown cell with fewest candidates,
+ * 81 if the sudoku is complete, -1 if it has no solution
+ */
+int branch_cell(unsigned int sudoku[9][9]);
+
+/* ************************************************************** *
+ *                           Generator                            *
+ * ************************************************************** */
+
+/** difficulty by the elimination needed to solve a sudoku, see grade() */
+enum grade {
+    /** naked singles */
+    grade_easy = 0,
+    /** hidden singles as well */
+    grade_medium = 1,
+    /** all strategies */
+    grade_hard = 2,
+    /** guessing needed */
+    grade_expert = 3
+};
+
+/** full grids tried by generate_puzzle() before it gives up */
+#define GENERATE_ATTEMPTS 100
+
+/**
+ * @brief Difficulty of the sudoku.
+ *
+ * @param sudoku 2D array of digit bitsets, not modified
+ * @return enum grade value, -1 for an invalid sudoku
+ */
+int grade(unsigned int sudoku[9][9]);
+
+/**
+ * @brief Generate a sudoku with a unique solution.
+ *
+ * Clues of a random complete grid are removed in random order while the
+ * solution stays unique, the grade stays at most level and more than
+ * clues of them are left. The result depends on the seed only.
+ * Reentrant and silent.
+ *
+ * @param sudoku 2D array to store digit bitsets, passed in undefined state.
+ * @param seed of the random stream
+ * @param clues at most this many digits are left, 0 for as few as possible
+ * @param level required enum grade value, -1 for any
+ * @return false if no such sudoku was found in GENERATE_ATTEMPTS grids
+ */
+bool generate_puzzle(unsigned int sudoku[9][9], uint64_t seed, int clues, int level);
+
 #endif //SUDOKU_H
@@ -0,0 +1,7 @@
+/* 16x16 sudokus, see engine.h */
+#include <stdint.h>
+
+#define BOX 4
+#define CELL uint16_t
+#define ENGINE engine16
+#include "engine_impl.h"
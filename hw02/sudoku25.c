@@ -0,0 +1,7 @@
+/* 25x25 sudokus, see engine.h */
+#include <stdint.h>
+
+#define BOX 5
+#define CELL uint32_t
+#define ENGINE engine25
+#include "engine_impl.h"